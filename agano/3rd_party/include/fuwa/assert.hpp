@@ -4,6 +4,7 @@
 #include <cstdio>
 #include <format>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 #include "types.hpp"
@@ -35,6 +36,34 @@ do { \
 } \
 while(false); 
 
+// Tells the optimizer that cond holds; undefined behaviour if cond is false. [[assume]], __builtin_assume and __assume
+// never evaluate cond, but the fallback for GCC before 13 does, so cond must be cheap and free of side effects.
+#if defined(__has_cpp_attribute) && __has_cpp_attribute(assume)
+	#define EH_ASSUME(cond) do { [[assume(cond)]]; } while(false);
+#elif defined(__clang__)
+	#define EH_ASSUME(cond) do { __builtin_assume(cond); } while(false);
+#elif defined(_MSC_VER)
+	#define EH_ASSUME(cond) do { __assume(cond); } while(false);
+#else
+	#define EH_ASSUME(cond) do { if(!(cond)) { __builtin_unreachable(); } } while(false);
+#endif
+
+// Checked like EH_ASSERT in debug builds; in release builds (NDEBUG) only an optimizer hint, so cond must have no side effects.
+#if defined(NDEBUG)
+	#define EH_DEBUG_ASSERT(cond, message) EH_ASSUME(cond)
+#else
+	#define EH_DEBUG_ASSERT(cond, message) EH_ASSERT(cond, message)
+#endif
+
+// Panics in debug builds; in release builds control flow reaching it is undefined behaviour.
+#if !defined(NDEBUG)
+	#define EH_UNREACHABLE() EH_PANIC("Reached code marked as unreachable")
+#elif defined(_MSC_VER) && !defined(__clang__)
+	#define EH_UNREACHABLE() do { __assume(false); } while(false);
+#else
+	#define EH_UNREACHABLE() do { __builtin_unreachable(); } while(false);
+#endif
+
 #define EH_WARN(message)\
 do { \
 	auto tokens = ::eh::DebugMessenger::make_warning(message, __FILE__, __LINE__); \
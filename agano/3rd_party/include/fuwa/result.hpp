@@ -113,6 +113,14 @@ namespace eh {
 			return std::move(result_);
 		}
 
+		// Same as unwrap() for callers that already know the result is ok; the check is compiled out in release builds.
+		[[nodiscard]]
+		Res unwrap_unchecked() && noexcept {
+			EH_DEBUG_ASSERT(is_ok(), "Called Result<>::unwrap_unchecked() on an error value");
+
+			return std::move(result_);
+		}
+
 		[[nodiscard]]
 		Res expect(std::string_view error) && noexcept {
 			EH_ASSERT(is_ok(), error);
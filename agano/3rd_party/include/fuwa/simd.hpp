@@ -0,0 +1,462 @@
+#pragma once
+#include <bit>
+#include <cstring>
+
+#include "types.hpp"
+
+// Backend is picked at compile time from the target flags. Define FUWA_SIMD_SCALAR to force the portable fallback.
+#if !defined(FUWA_SIMD_SCALAR)
+	#if defined(__AVX2__)
+		#define FUWA_SIMD_AVX2 1
+		#define FUWA_SIMD_SSE2 1
+	#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define FUWA_SIMD_SSE2 1
+	#elif defined(__ARM_NEON) && defined(__aarch64__)
+		#define FUWA_SIMD_NEON 1
+	#else
+		#define FUWA_SIMD_SCALAR 1
+	#endif
+#endif
+
+#if defined(FUWA_SIMD_AVX2)
+	#include <immintrin.h>
+#elif defined(FUWA_SIMD_SSE2)
+	#include <emmintrin.h>
+#elif defined(FUWA_SIMD_NEON)
+	#include <arm_neon.h>
+#endif
+
+namespace eh::simd {
+	enum class Backend {
+		eScalar = 0,
+		eSSE2,
+		eAVX2,
+		eNEON,
+	};
+
+#if defined(FUWA_SIMD_AVX2)
+	inline constexpr Backend backend = Backend::eAVX2;
+#elif defined(FUWA_SIMD_SSE2)
+	inline constexpr Backend backend = Backend::eSSE2;
+#elif defined(FUWA_SIMD_NEON)
+	inline constexpr Backend backend = Backend::eNEON;
+#else
+	inline constexpr Backend backend = Backend::eScalar;
+#endif
+
+	/*
+	* Fixed-width vectors over the scalar aliases. Loads and stores are unaligned. Comparisons return a vector
+	* of the same type with every lane either all ones or all zeros; movemask() packs the lanes' top bits
+	* into an integer, lane 0 in bit 0.
+	*/
+	struct u8x16 {
+		static constexpr usize lanes = 16;
+		static constexpr u32 full_mask = 0xffffu;
+
+#if defined(FUWA_SIMD_SSE2)
+		__m128i value;
+#elif defined(FUWA_SIMD_NEON)
+		uint8x16_t value;
+#else
+		u8 value[lanes];
+#endif
+
+		static u8x16 load(const u8* src) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+			return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)) };
+#elif defined(FUWA_SIMD_NEON)
+			return { vld1q_u8(src) };
+#else
+			u8x16 result;
+			std::memcpy(result.value, src, sizeof(result.value));
+			return result;
+#endif
+		}
+
+		static u8x16 splat(u8 x) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+			return { _mm_set1_epi8(static_cast<char>(x)) };
+#elif defined(FUWA_SIMD_NEON)
+			return { vdupq_n_u8(x) };
+#else
+			u8x16 result;
+			std::memset(result.value, x, sizeof(result.value));
+			return result;
+#endif
+		}
+
+		void store(u8* dst) const noexcept {
+#if defined(FUWA_SIMD_SSE2)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+#elif defined(FUWA_SIMD_NEON)
+			vst1q_u8(dst, value);
+#else
+			std::memcpy(dst, value, sizeof(value));
+#endif
+		}
+	};
+
+	struct u32x4 {
+		static constexpr usize lanes = 4;
+		static constexpr u32 full_mask = 0xfu;
+
+#if defined(FUWA_SIMD_SSE2)
+		__m128i value;
+#elif defined(FUWA_SIMD_NEON)
+		uint32x4_t value;
+#else
+		u32 value[lanes];
+#endif
+
+		static u32x4 load(const u32* src) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+			return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)) };
+#elif defined(FUWA_SIMD_NEON)
+			return { vld1q_u32(src) };
+#else
+			u32x4 result;
+			std::memcpy(result.value, src, sizeof(result.value));
+			return result;
+#endif
+		}
+
+		static u32x4 splat(u32 x) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+			return { _mm_set1_epi32(static_cast<i32>(x)) };
+#elif defined(FUWA_SIMD_NEON)
+			return { vdupq_n_u32(x) };
+#else
+			return { { x, x, x, x } };
+#endif
+		}
+
+		void store(u32* dst) const noexcept {
+#if defined(FUWA_SIMD_SSE2)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+#elif defined(FUWA_SIMD_NEON)
+			vst1q_u32(dst, value);
+#else
+			std::memcpy(dst, value, sizeof(value));
+#endif
+		}
+	};
+
+	struct u64x2 {
+		static constexpr usize lanes = 2;
+		static constexpr u32 full_mask = 0x3u;
+
+#if defined(FUWA_SIMD_SSE2)
+		__m128i value;
+#elif defined(FUWA_SIMD_NEON)
+		uint64x2_t value;
+#else
+		u64 value[lanes];
+#endif
+
+		static u64x2 load(const u64* src) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+			return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)) };
+#elif defined(FUWA_SIMD_NEON)
+			return { vld1q_u64(src) };
+#else
+			u64x2 result;
+			std::memcpy(result.value, src, sizeof(result.value));
+			return result;
+#endif
+		}
+
+		static u64x2 splat(u64 x) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+			return { _mm_set1_epi64x(static_cast<i64>(x)) };
+#elif defined(FUWA_SIMD_NEON)
+			return { vdupq_n_u64(x) };
+#else
+			return { { x, x } };
+#endif
+		}
+
+		void store(u64* dst) const noexcept {
+#if defined(FUWA_SIMD_SSE2)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+#elif defined(FUWA_SIMD_NEON)
+			vst1q_u64(dst, value);
+#else
+			std::memcpy(dst, value, sizeof(value));
+#endif
+		}
+	};
+
+	// 256-bit vectors: one register with AVX2, two 128-bit halves otherwise.
+	struct u8x32 {
+		static constexpr usize lanes = 32;
+		static constexpr u32 full_mask = 0xffffffffu;
+
+#if defined(FUWA_SIMD_AVX2)
+		__m256i value;
+#else
+		u8x16 low;
+		u8x16 high;
+#endif
+
+		static u8x32 load(const u8* src) noexcept {
+#if defined(FUWA_SIMD_AVX2)
+			return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)) };
+#else
+			return { u8x16::load(src), u8x16::load(src + 16) };
+#endif
+		}
+
+		static u8x32 splat(u8 x) noexcept {
+#if defined(FUWA_SIMD_AVX2)
+			return { _mm256_set1_epi8(static_cast<char>(x)) };
+#else
+			return { u8x16::splat(x), u8x16::splat(x) };
+#endif
+		}
+
+		void store(u8* dst) const noexcept {
+#if defined(FUWA_SIMD_AVX2)
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), value);
+#else
+			low.store(dst);
+			high.store(dst + 16);
+#endif
+		}
+	};
+
+	struct u64x4 {
+		static constexpr usize lanes = 4;
+		static constexpr u32 full_mask = 0xfu;
+
+#if defined(FUWA_SIMD_AVX2)
+		__m256i value;
+#else
+		u64x2 low;
+		u64x2 high;
+#endif
+
+		static u64x4 load(const u64* src) noexcept {
+#if defined(FUWA_SIMD_AVX2)
+			return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)) };
+#else
+			return { u64x2::load(src), u64x2::load(src + 2) };
+#endif
+		}
+
+		static u64x4 splat(u64 x) noexcept {
+#if defined(FUWA_SIMD_AVX2)
+			return { _mm256_set1_epi64x(static_cast<i64>(x)) };
+#else
+			return { u64x2::splat(x), u64x2::splat(x) };
+#endif
+		}
+
+		void store(u64* dst) const noexcept {
+#if defined(FUWA_SIMD_AVX2)
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), value);
+#else
+			low.store(dst);
+			high.store(dst + 2);
+#endif
+		}
+	};
+
+	// Bitwise operations, the same for every 128-bit type.
+#if defined(FUWA_SIMD_SSE2)
+	#define FUWA_SIMD_BITWISE_128(type, lane) \
+	inline type operator&(type a, type b) noexcept { return { _mm_and_si128(a.value, b.value) }; } \
+	inline type operator|(type a, type b) noexcept { return { _mm_or_si128(a.value, b.value) }; } \
+	inline type operator^(type a, type b) noexcept { return { _mm_xor_si128(a.value, b.value) }; } \
+	inline type operator~(type a) noexcept { return { _mm_xor_si128(a.value, _mm_set1_epi32(-1)) }; }
+#elif defined(FUWA_SIMD_NEON)
+	#define FUWA_SIMD_BITWISE_128(type, lane) \
+	inline type operator&(type a, type b) noexcept { return { vandq_##lane(a.value, b.value) }; } \
+	inline type operator|(type a, type b) noexcept { return { vorrq_##lane(a.value, b.value) }; } \
+	inline type operator^(type a, type b) noexcept { return { veorq_##lane(a.value, b.value) }; } \
+	inline type operator~(type a) noexcept { return { veorq_##lane(a.value, vdupq_n_##lane(static_cast<lane>(~lane{ 0 }))) }; }
+#else
+	#define FUWA_SIMD_BITWISE_128(type, lane) \
+	inline type operator&(type a, type b) noexcept { for (usize i = 0; i < type::lanes; ++i) { a.value[i] &= b.value[i]; } return a; } \
+	inline type operator|(type a, type b) noexcept { for (usize i = 0; i < type::lanes; ++i) { a.value[i] |= b.value[i]; } return a; } \
+	inline type operator^(type a, type b) noexcept { for (usize i = 0; i < type::lanes; ++i) { a.value[i] ^= b.value[i]; } return a; } \
+	inline type operator~(type a) noexcept { for (usize i = 0; i < type::lanes; ++i) { a.value[i] = static_cast<lane>(~a.value[i]); } return a; }
+#endif
+
+	FUWA_SIMD_BITWISE_128(u8x16, u8)
+	FUWA_SIMD_BITWISE_128(u32x4, u32)
+	FUWA_SIMD_BITWISE_128(u64x2, u64)
+
+#undef FUWA_SIMD_BITWISE_128
+
+#if defined(FUWA_SIMD_AVX2)
+	#define FUWA_SIMD_BITWISE_256(type) \
+	inline type operator&(type a, type b) noexcept { return { _mm256_and_si256(a.value, b.value) }; } \
+	inline type operator|(type a, type b) noexcept { return { _mm256_or_si256(a.value, b.value) }; } \
+	inline type operator^(type a, type b) noexcept { return { _mm256_xor_si256(a.value, b.value) }; } \
+	inline type operator~(type a) noexcept { return { _mm256_xor_si256(a.value, _mm256_set1_epi32(-1)) }; }
+#else
+	#define FUWA_SIMD_BITWISE_256(type) \
+	inline type operator&(type a, type b) noexcept { return { a.low & b.low, a.high & b.high }; } \
+	inline type operator|(type a, type b) noexcept { return { a.low | b.low, a.high | b.high }; } \
+	inline type operator^(type a, type b) noexcept { return { a.low ^ b.low, a.high ^ b.high }; } \
+	inline type operator~(type a) noexcept { return { ~a.low, ~a.high }; }
+#endif
+
+	FUWA_SIMD_BITWISE_256(u8x32)
+	FUWA_SIMD_BITWISE_256(u64x4)
+
+#undef FUWA_SIMD_BITWISE_256
+
+	// Lane-wise equality.
+	inline u8x16 cmp_eq(u8x16 a, u8x16 b) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+		return { _mm_cmpeq_epi8(a.value, b.value) };
+#elif defined(FUWA_SIMD_NEON)
+		return { vceqq_u8(a.value, b.value) };
+#else
+		for (usize i = 0; i < u8x16::lanes; ++i) {
+			a.value[i] = a.value[i] == b.value[i] ? 0xffu : 0u;
+		}
+		return a;
+#endif
+	}
+
+	inline u32x4 cmp_eq(u32x4 a, u32x4 b) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+		return { _mm_cmpeq_epi32(a.value, b.value) };
+#elif defined(FUWA_SIMD_NEON)
+		return { vceqq_u32(a.value, b.value) };
+#else
+		for (usize i = 0; i < u32x4::lanes; ++i) {
+			a.value[i] = a.value[i] == b.value[i] ? ~u32{ 0 } : 0u;
+		}
+		return a;
+#endif
+	}
+
+	inline u64x2 cmp_eq(u64x2 a, u64x2 b) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+		// SSE2 has no 64-bit compare: both 32-bit halves of a lane must be equal.
+		const __m128i halves = _mm_cmpeq_epi32(a.value, b.value);
+		return { _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1))) };
+#elif defined(FUWA_SIMD_NEON)
+		return { vceqq_u64(a.value, b.value) };
+#else
+		for (usize i = 0; i < u64x2::lanes; ++i) {
+			a.value[i] = a.value[i] == b.value[i] ? ~u64{ 0 } : 0u;
+		}
+		return a;
+#endif
+	}
+
+	inline u8x32 cmp_eq(u8x32 a, u8x32 b) noexcept {
+#if defined(FUWA_SIMD_AVX2)
+		return { _mm256_cmpeq_epi8(a.value, b.value) };
+#else
+		return { cmp_eq(a.low, b.low), cmp_eq(a.high, b.high) };
+#endif
+	}
+
+	inline u64x4 cmp_eq(u64x4 a, u64x4 b) noexcept {
+#if defined(FUWA_SIMD_AVX2)
+		return { _mm256_cmpeq_epi64(a.value, b.value) };
+#else
+		return { cmp_eq(a.low, b.low), cmp_eq(a.high, b.high) };
+#endif
+	}
+
+	// Top bit of every lane, lane 0 in bit 0.
+	inline u32 movemask(u8x16 v) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+		return static_cast<u32>(_mm_movemask_epi8(v.value));
+#elif defined(FUWA_SIMD_NEON)
+		static constexpr i8 shifts[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7 };
+		const uint8x16_t bits = vshlq_u8(vshrq_n_u8(v.value, 7), vld1q_s8(shifts));
+		return static_cast<u32>(vaddv_u8(vget_low_u8(bits))) | (static_cast<u32>(vaddv_u8(vget_high_u8(bits))) << 8u);
+#else
+		u32 mask = 0;
+		for (usize i = 0; i < u8x16::lanes; ++i) {
+			mask |= static_cast<u32>(v.value[i] >> 7u) << i;
+		}
+		return mask;
+#endif
+	}
+
+	inline u32 movemask(u32x4 v) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+		return static_cast<u32>(_mm_movemask_ps(_mm_castsi128_ps(v.value)));
+#elif defined(FUWA_SIMD_NEON)
+		static constexpr i32 shifts[4] = { 0, 1, 2, 3 };
+		return vaddvq_u32(vshlq_u32(vshrq_n_u32(v.value, 31), vld1q_s32(shifts)));
+#else
+		u32 mask = 0;
+		for (usize i = 0; i < u32x4::lanes; ++i) {
+			mask |= (v.value[i] >> 31u) << i;
+		}
+		return mask;
+#endif
+	}
+
+	inline u32 movemask(u64x2 v) noexcept {
+#if defined(FUWA_SIMD_SSE2)
+		return static_cast<u32>(_mm_movemask_pd(_mm_castsi128_pd(v.value)));
+#elif defined(FUWA_SIMD_NEON)
+		const uint64x2_t bits = vshrq_n_u64(v.value, 63);
+		return static_cast<u32>(vgetq_lane_u64(bits, 0) | (vgetq_lane_u64(bits, 1) << 1u));
+#else
+		return static_cast<u32>((v.value[0] >> 63u) | ((v.value[1] >> 63u) << 1u));
+#endif
+	}
+
+	inline u32 movemask(u8x32 v) noexcept {
+#if defined(FUWA_SIMD_AVX2)
+		return static_cast<u32>(_mm256_movemask_epi8(v.value));
+#else
+		return movemask(v.low) | (movemask(v.high) << 16u);
+#endif
+	}
+
+	inline u32 movemask(u64x4 v) noexcept {
+#if defined(FUWA_SIMD_AVX2)
+		return static_cast<u32>(_mm256_movemask_pd(_mm256_castsi256_pd(v.value)));
+#else
+		return movemask(v.low) | (movemask(v.high) << 2u);
+#endif
+	}
+
+	// Number of set bits in the whole vector.
+	template<typename V>
+	inline u32 popcount(V v) noexcept {
+#if defined(FUWA_SIMD_NEON)
+		if constexpr (sizeof(V) == 16) {
+			uint8x16_t bytes;
+			std::memcpy(&bytes, &v, sizeof(bytes));
+			return vaddlvq_u8(vcntq_u8(bytes));
+		}
+#endif
+		u64 words[sizeof(V) / sizeof(u64)];
+		std::memcpy(words, &v, sizeof(words));
+
+		u32 count = 0;
+		for (u64 word : words) {
+			count += static_cast<u32>(std::popcount(word));
+		}
+		return count;
+	}
+
+	// Mask helpers for the results of cmp_eq().
+	template<typename V>
+	inline bool any(V mask) noexcept {
+		return movemask(mask) != 0;
+	}
+
+	template<typename V>
+	inline bool all(V mask) noexcept {
+		return movemask(mask) == V::full_mask;
+	}
+
+	template<typename V>
+	inline bool none(V mask) noexcept {
+		return movemask(mask) == 0;
+	}
+}
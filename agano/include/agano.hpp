@@ -1,11 +1,15 @@
 #pragma once
 #include "agano.hpp"
 #include <algorithm>
+#include <atomic>
 #include <concepts>
 #include <exception>
+#include <optional>
+#include <stop_token>
 #include <thread>
 #include <type_traits>
 #include <mutex>
+#include <utility>
 
 #include <fuwa/types.hpp>
 #include <fuwa/assert.hpp>
@@ -31,7 +35,7 @@ namespace agano {
     class Locked {
     private:
         T& ref_;
-        std::lock_guard<M> lock_;
+        std::unique_lock<M> lock_;
 
     public:
         Locked(T& ref, M& mutex) noexcept 
@@ -39,6 +43,11 @@ namespace agano {
             , lock_{ mutex }
         {}
 
+        Locked(T& ref, std::unique_lock<M>&& lock) noexcept 
+            : ref_{ ref }
+            , lock_{ std::move(lock) }
+        {}
+
         Locked(Locked&&) noexcept = delete;
         Locked& operator=(Locked&&) noexcept = delete;
 
@@ -68,6 +77,8 @@ namespace agano {
     class Synced {
     private:
         M mutex_;
+        // Bumped by notify_one()/notify_all() and by stop requests; lock_when() sleeps on it while pred is false.
+        std::atomic<u32> wake_epoch_{ 0 };
         T owned_;
 
     public:
@@ -89,6 +100,68 @@ namespace agano {
             return Locked{ owned_, mutex_ };
         }
 
+        /*
+        * Blocks until pred(const T&) holds and returns the lock. Whoever changes the object in a way
+        * that can make pred true must call notify_one() or notify_all() afterwards.
+        */
+        template<std::predicate<const T&> Pred>
+        [[nodiscard]]
+        Locked<T, M> lock_when(Pred pred) noexcept {
+            while (true) {
+                std::unique_lock<M> lock{ mutex_ };
+                if (pred(std::as_const(owned_))) {
+                    return Locked<T, M>{ owned_, std::move(lock) };
+                }
+
+                // Read under the lock: a change made after we unlock is followed by a notify that bumps the epoch.
+                const u32 epoch = wake_epoch_.load(std::memory_order_acquire);
+                lock.unlock();
+                wake_epoch_.wait(epoch, std::memory_order_acquire);
+            }
+        }
+
+        // Same as lock_when(pred), but gives up and returns std::nullopt once stop is requested on token.
+        template<std::predicate<const T&> Pred>
+        [[nodiscard]]
+        std::optional<Locked<T, M>> lock_when(std::stop_token token, Pred pred) noexcept {
+            // Never takes the mutex, so request_stop() may be called by a thread that holds the lock.
+            std::stop_callback wake{ token, [this] { bump_epoch_(true); } };
+
+            while (true) {
+                std::unique_lock<M> lock{ mutex_ };
+                if (pred(std::as_const(owned_))) {
+                    return std::optional<Locked<T, M>>{ std::in_place, owned_, std::move(lock) };
+                }
+
+                const u32 epoch = wake_epoch_.load(std::memory_order_acquire);
+                lock.unlock();
+
+                // Checked after reading the epoch: a later stop request bumps it, so the wait below returns.
+                if (token.stop_requested()) {
+                    return std::nullopt;
+                }
+                wake_epoch_.wait(epoch, std::memory_order_acquire);
+            }
+        }
+
+        void notify_one() noexcept {
+            bump_epoch_(false);
+        }
+
+        void notify_all() noexcept {
+            bump_epoch_(true);
+        }
+
+    private:
+        void bump_epoch_(bool all) noexcept {
+            wake_epoch_.fetch_add(1, std::memory_order_acq_rel);
+            if (all) {
+                wake_epoch_.notify_all();
+            }
+            else {
+                wake_epoch_.notify_one();
+            }
+        }
     };
 
     struct DeferBindingTag{};
@@ -232,4 +305,7 @@ namespace agano {
 
     template<>
     inline constexpr bool send_tag_v<int> = true;
+
+    template<>
+    inline constexpr bool send_tag_v<const int&> = true;
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <concepts>
+#include <utility>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "agano.hpp"
+
+namespace agano {
+    template<typename T>
+    class AtomicArc;
+
+    template<std::copy_constructible T>
+    class Cow;
+
+    /*
+    * Arc<T> is a shared handle to an immutable heap-allocated T with an atomic reference count.
+    * It is the value type loaded from and stored into an AtomicArc<T> and the storage behind Cow<T>.
+    * A default or moved-from Arc is empty.
+    */
+    template<typename T>
+    class Arc {
+    private:
+        struct Block {
+            std::atomic<u64> refs{ 1 };
+            T value;
+
+            template<typename... Args>
+            explicit Block(std::in_place_t, Args&&... args) noexcept
+                : value(std::forward<Args>(args)...)
+            {}
+        };
+
+        Block* block_ = nullptr;
+
+        // Adopts one reference that the caller already holds.
+        explicit Arc(Block* block) noexcept
+            : block_{ block }
+        {}
+
+        friend class AtomicArc<T>;
+        friend class Cow<T>;
+
+        template<typename U, typename... Args>
+        friend Arc<U> make_arc(Args&&... args) noexcept;
+
+    public:
+        Arc() noexcept = default;
+
+        Arc(const Arc& rhs) noexcept
+            : block_{ rhs.block_ }
+        {
+            if (block_ != nullptr) {
+                block_->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        Arc& operator=(const Arc& rhs) noexcept {
+            Arc{ rhs }.swap(*this);
+            return *this;
+        }
+
+        Arc(Arc&& rhs) noexcept
+            : block_{ std::exchange(rhs.block_, nullptr) }
+        {}
+
+        Arc& operator=(Arc&& rhs) noexcept {
+            Arc{ std::move(rhs) }.swap(*this);
+            return *this;
+        }
+
+        ~Arc() noexcept {
+            release_(block_, 1);
+        }
+
+        const T* operator->() const noexcept {
+            EH_ASSERT(block_ != nullptr, "Access to an empty Arc");
+            return &block_->value;
+        }
+
+        const T& operator*() const noexcept {
+            EH_ASSERT(block_ != nullptr, "Access to an empty Arc");
+            return block_->value;
+        }
+
+        const T* get() const noexcept {
+            return block_ != nullptr ? &block_->value : nullptr;
+        }
+
+        explicit operator bool() const noexcept {
+            return block_ != nullptr;
+        }
+
+        bool same_as(const Arc& rhs) const noexcept {
+            return block_ == rhs.block_;
+        }
+
+        void swap(Arc& rhs) noexcept {
+            std::swap(block_, rhs.block_);
+        }
+
+    private:
+        static void release_(Block* block, u64 count) noexcept {
+            if (block != nullptr && count != 0 && block->refs.fetch_sub(count, std::memory_order_acq_rel) == count) {
+                delete block;
+            }
+        }
+    };
+
+    template<typename T, typename... Args>
+    Arc<T> make_arc(Args&&... args) noexcept {
+        return Arc<T>{ new typename Arc<T>::Block{ std::in_place, std::forward<Args>(args)... } };
+    }
+
+    // Handles on different threads share one T and may drop it on any of them, so both need T: Send + Sync.
+    template<typename T> requires Send<T> && Sync<T>
+    inline constexpr bool send_tag_v<Arc<T>> = true;
+
+    template<typename T> requires Send<T> && Sync<T>
+    inline constexpr bool send_tag_v<const Arc<T>&> = true;
+}
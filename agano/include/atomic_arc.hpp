@@ -0,0 +1,151 @@
+#pragma once
+#include <atomic>
+#include <concepts>
+#include <utility>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "agano.hpp"
+#include "arc.hpp"
+
+namespace agano {
+    /*
+    * AtomicArc<T> is an atomically replaceable Arc<T> whose load() is lock-free: one fetch_add, no CAS loop.
+    * The pointer shares a 64-bit word with a 16-bit counter of handed-out references. When a block is stored
+    * its reference count is charged with a batch of `batch` references up front, and each load() takes one of
+    * them by bumping the counter, so readers never touch the block's count. A reader that sees the batch half
+    * used moves more references from the block to the word. Replacing the pointer returns the unused part.
+    * Requires 48-bit user-space pointers (x86-64, AArch64).
+    */
+    template<typename T>
+    class AtomicArc {
+    private:
+        using Block = typename Arc<T>::Block;
+
+        static constexpr u64 count_shift = 48u;
+        static constexpr u64 count_one = u64{ 1 } << count_shift;
+        static constexpr u64 pointer_mask = count_one - 1;
+        static constexpr u64 batch = u64{ 1 } << 15u;
+        static constexpr u64 refill = batch / 2;
+
+        static_assert(sizeof(void*) == sizeof(u64), "AtomicArc packs a pointer and a counter into one 64-bit word");
+
+        // load() takes references by bumping the counter, so even const readers modify the word.
+        mutable std::atomic<u64> word_{ 0 };
+
+    public:
+        AtomicArc() noexcept = default;
+
+        explicit AtomicArc(Arc<T> value) noexcept
+            : word_{ charge_(std::move(value)) }
+        {}
+
+        AtomicArc(AtomicArc&&) noexcept = delete;
+        AtomicArc& operator=(AtomicArc&&) noexcept = delete;
+
+        AtomicArc(const AtomicArc&) = delete;
+        AtomicArc& operator=(const AtomicArc&) = delete;
+
+        ~AtomicArc() noexcept {
+            discharge_(word_.load(std::memory_order_acquire), 0);
+        }
+
+        [[nodiscard]]
+        Arc<T> load() const noexcept {
+            u64 word = word_.fetch_add(count_one, std::memory_order_acquire) + count_one;
+            Block* block = block_of_(word);
+            if (block == nullptr) {
+                return Arc<T>{};
+            }
+
+            if (count_of_(word) >= refill) {
+                // Move `refill` references from the block into the word. Adding first keeps the block alive and
+                // the total balanced whichever epoch the CAS lands in, so a recycled pointer (ABA) is harmless.
+                block->refs.fetch_add(refill, std::memory_order_relaxed);
+                bool moved = false;
+                while (block_of_(word) == block && count_of_(word) >= refill) {
+                    if (word_.compare_exchange_weak(word, word - refill * count_one, std::memory_order_relaxed)) {
+                        moved = true;
+                        break;
+                    }
+                }
+
+                if (!moved) {
+                    // We still own the reference we took, so this cannot drop the count to zero.
+                    block->refs.fetch_sub(refill, std::memory_order_relaxed);
+                }
+            }
+            return Arc<T>{ block };
+        }
+
+        void store(Arc<T> value) noexcept {
+            discharge_(word_.exchange(charge_(std::move(value)), std::memory_order_acq_rel), 0);
+        }
+
+        [[nodiscard]]
+        Arc<T> exchange(Arc<T> value) noexcept {
+            const u64 old = word_.exchange(charge_(std::move(value)), std::memory_order_acq_rel);
+            discharge_(old, 1);
+            return Arc<T>{ block_of_(old) };
+        }
+
+        /*
+        * Stores desired if the current value is the same object as expected. On failure expected is replaced
+        * with the current value. Compares identity, not the pointed-to values.
+        */
+        bool compare_exchange(Arc<T>& expected, Arc<T> desired) noexcept {
+            const u64 fresh = charge_(std::move(desired));
+
+            u64 word = word_.load(std::memory_order_relaxed);
+            while (block_of_(word) == expected.block_) {
+                if (word_.compare_exchange_weak(word, fresh, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                    discharge_(word, 0);
+                    return true;
+                }
+            }
+
+            discharge_(fresh, 0);
+            expected = load();
+            return false;
+        }
+
+        bool is_lock_free() const noexcept {
+            return word_.is_lock_free();
+        }
+
+    private:
+        static Block* block_of_(u64 word) noexcept {
+            return reinterpret_cast<Block*>(static_cast<uintptr_t>(word & pointer_mask));
+        }
+
+        static u64 count_of_(u64 word) noexcept {
+            return word >> count_shift;
+        }
+
+        // Turns the handle's reference into a freshly charged word with `batch` references available.
+        static u64 charge_(Arc<T> value) noexcept {
+            Block* block = std::exchange(value.block_, nullptr);
+            if (block == nullptr) {
+                return 0;
+            }
+
+            const auto address = reinterpret_cast<uintptr_t>(block);
+            EH_ASSERT((address & ~pointer_mask) == 0, "AtomicArc needs pointers that fit in 48 bits");
+            block->refs.fetch_add(batch - 1, std::memory_order_relaxed);
+            return static_cast<u64>(address);
+        }
+
+        // Returns the references of a word that is no longer stored, keeping `keep` of them for the caller.
+        static void discharge_(u64 word, u64 keep) noexcept {
+            Arc<T>::release_(block_of_(word), batch - count_of_(word) - keep);
+        }
+    };
+
+    // AtomicArc cannot be moved, only shared; it hands out Arc<T>, so it is shareable exactly when Arc<T> is.
+    template<typename T> requires Send<Arc<T>>
+    inline constexpr bool send_tag_v<AtomicArc<T>&> = true;
+
+    template<typename T> requires Send<Arc<T>>
+    inline constexpr bool send_tag_v<const AtomicArc<T>&> = true;
+}
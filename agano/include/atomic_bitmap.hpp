@@ -0,0 +1,288 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <memory>
+#include <optional>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+namespace agano {
+    namespace detail {
+        // Word where the calling thread last found a free bit, shared by all bitmaps. Only a search hint.
+        inline usize& bitmap_hint() noexcept {
+            thread_local usize hint = 0;
+            return hint;
+        }
+    }
+
+    /*
+    * AtomicBitmap is a fixed-size bitmap of atomic 64-bit words that many threads can set and clear at once.
+    * find_first_zero_and_set() finds a free bit with a count-trailing-zeros of the inverted word and claims it
+    * with a CAS. One summary bit per word records that the word is full, so a search skips 64 full words with
+    * one load. Summary bits are maintained after the word update and may lag behind for a moment; they only
+    * steer the search, which falls back to a plain scan before giving up.
+    */
+    class AtomicBitmap {
+    private:
+        static constexpr u64 full = std::numeric_limits<u64>::max();
+        static constexpr usize word_bits = 64u;
+
+        std::unique_ptr<std::atomic<u64>[]> words_;
+        // Bit j of summary word i is set if word i * 64 + j is full.
+        std::unique_ptr<std::atomic<u64>[]> summary_;
+        usize size_;
+        usize word_count_;
+        usize summary_count_;
+
+    public:
+        explicit AtomicBitmap(usize size) noexcept
+            : words_{ std::make_unique<std::atomic<u64>[]>(std::max<usize>((size + word_bits - 1) / word_bits, 1u)) }
+            , summary_{ std::make_unique<std::atomic<u64>[]>(std::max<usize>((size + word_bits * word_bits - 1) / (word_bits * word_bits), 1u)) }
+            , size_{ size }
+            , word_count_{ std::max<usize>((size + word_bits - 1) / word_bits, 1u) }
+            , summary_count_{ std::max<usize>((size + word_bits * word_bits - 1) / (word_bits * word_bits), 1u) }
+        {
+            // Bits past the end are permanently set, so searches never hand them out.
+            const usize tail = size % word_bits;
+            if (tail != 0 || size == 0) {
+                words_[word_count_ - 1].store(full << tail, std::memory_order_relaxed);
+                if (size == 0) {
+                    mark_full_(0);
+                }
+            }
+            // Summary bits past the last word are set as well.
+            const usize summary_tail = word_count_ % word_bits;
+            if (summary_tail != 0) {
+                summary_[summary_count_ - 1].fetch_or(full << summary_tail, std::memory_order_relaxed);
+            }
+        }
+
+        AtomicBitmap(AtomicBitmap&&) noexcept = delete;
+        AtomicBitmap& operator=(AtomicBitmap&&) noexcept = delete;
+
+        AtomicBitmap(const AtomicBitmap&) = delete;
+        AtomicBitmap& operator=(const AtomicBitmap&) = delete;
+
+        usize size() const noexcept {
+            return size_;
+        }
+
+        bool test(usize index) const noexcept {
+            EH_DEBUG_ASSERT(index < size_, "Bit index out of range");
+            return (words_[index / word_bits].load(std::memory_order_acquire) >> (index % word_bits)) & 1u;
+        }
+
+        // Returns the previous value of the bit.
+        bool set(usize index) noexcept {
+            EH_DEBUG_ASSERT(index < size_, "Bit index out of range");
+            const usize word = index / word_bits;
+            const u64 bit = u64{ 1 } << (index % word_bits);
+            const u64 old = words_[word].fetch_or(bit, std::memory_order_acq_rel);
+            if ((old | bit) == full && old != full) {
+                mark_full_(word);
+            }
+            return (old & bit) != 0;
+        }
+
+        // Returns the previous value of the bit.
+        bool clear(usize index) noexcept {
+            EH_DEBUG_ASSERT(index < size_, "Bit index out of range");
+            const usize word = index / word_bits;
+            const u64 bit = u64{ 1 } << (index % word_bits);
+            const u64 old = words_[word].fetch_and(~bit, std::memory_order_acq_rel);
+            if (old == full) {
+                mark_open_(word);
+            }
+            return (old & bit) != 0;
+        }
+
+        /*
+        * Sets the first clear bit at or after the word the calling thread last allocated from, wrapping around,
+        * and returns its index; std::nullopt if every bit is set. Threads that allocate a lot drift apart and
+        * stop fighting over the same word.
+        */
+        std::optional<usize> find_first_zero_and_set() noexcept {
+            usize& hint = detail::bitmap_hint();
+            const usize start = hint < word_count_ ? hint : 0;
+
+            // First pass: only words the summary does not mark as full.
+            const usize first_group = start / word_bits;
+            for (usize g = 0; g <= summary_count_; ++g) {
+                const usize group = (first_group + g) % summary_count_;
+                u64 open = ~summary_[group].load(std::memory_order_acquire);
+                if (g == 0) {
+                    // Begin at the hint inside the first group; its lower words are visited on the wrap-around.
+                    open &= full << (start % word_bits);
+                }
+                else if (g == summary_count_) {
+                    open &= ~(full << (start % word_bits));
+                }
+
+                while (open != 0) {
+                    const usize word = group * word_bits + static_cast<usize>(std::countr_zero(open));
+                    open &= open - 1;
+                    if (const auto index = claim_in_(word)) {
+                        hint = word;
+                        return index;
+                    }
+                }
+            }
+
+            // The summary may be stale; scan every word once before reporting the bitmap full.
+            for (usize word = 0; word < word_count_; ++word) {
+                if (const auto index = claim_in_(word)) {
+                    mark_open_(word);
+                    if (words_[word].load(std::memory_order_relaxed) == full) {
+                        mark_full_(word);
+                    }
+                    hint = word;
+                    return index;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // Sets bits [first, first + count). Whole words are written with one store each.
+        void set_range(usize first, usize count) noexcept {
+            EH_ASSERT(first + count <= size_, "Bit range out of range");
+            apply_range_(first, count, true);
+        }
+
+        // Clears bits [first, first + count). Whole words are written with one store each.
+        void clear_range(usize first, usize count) noexcept {
+            EH_ASSERT(first + count <= size_, "Bit range out of range");
+            apply_range_(first, count, false);
+        }
+
+        // Number of set bits. Not a snapshot while other threads modify the bitmap.
+        usize count() const noexcept {
+            usize total = 0;
+            for (usize word = 0; word < word_count_; ++word) {
+                total += static_cast<usize>(std::popcount(words_[word].load(std::memory_order_relaxed)));
+            }
+            // Padding bits of the last word are always set.
+            return total - (word_count_ * word_bits - size_);
+        }
+
+    private:
+        std::optional<usize> claim_in_(usize word) noexcept {
+            u64 value = words_[word].load(std::memory_order_relaxed);
+            while (value != full) {
+                const u64 bit = u64{ 1 } << std::countr_zero(~value);
+                if (words_[word].compare_exchange_weak(value, value | bit, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                    if ((value | bit) == full) {
+                        mark_full_(word);
+                    }
+                    return word * word_bits + static_cast<usize>(std::countr_zero(bit));
+                }
+            }
+            return std::nullopt;
+        }
+
+        void mark_full_(usize word) noexcept {
+            summary_[word / word_bits].fetch_or(u64{ 1 } << (word % word_bits), std::memory_order_release);
+        }
+
+        void mark_open_(usize word) noexcept {
+            summary_[word / word_bits].fetch_and(~(u64{ 1 } << (word % word_bits)), std::memory_order_release);
+        }
+
+        void apply_range_(usize first, usize count, bool value) noexcept {
+            if (count == 0) {
+                return;
+            }
+
+            const usize last = first + count - 1;
+            const usize first_word = first / word_bits;
+            const usize last_word = last / word_bits;
+
+            if (first_word == last_word) {
+                apply_mask_(first_word, range_mask_(first % word_bits, last % word_bits), value);
+                return;
+            }
+
+            apply_mask_(first_word, range_mask_(first % word_bits, word_bits - 1), value);
+            apply_mask_(last_word, range_mask_(0, last % word_bits), value);
+
+            // Interior words are covered completely: plain stores, then one summary update per 64 words.
+            for (usize word = first_word + 1; word < last_word;) {
+                const usize group_end = std::min(last_word, (word / word_bits + 1) * word_bits);
+                for (usize i = word; i < group_end; ++i) {
+                    words_[i].store(value ? full : 0, std::memory_order_release);
+                }
+
+                const u64 mask = range_mask_(word % word_bits, (group_end - 1) % word_bits);
+                if (value) {
+                    summary_[word / word_bits].fetch_or(mask, std::memory_order_release);
+                }
+                else {
+                    summary_[word / word_bits].fetch_and(~mask, std::memory_order_release);
+                }
+                word = group_end;
+            }
+        }
+
+        void apply_mask_(usize word, u64 mask, bool value) noexcept {
+            if (value) {
+                const u64 old = words_[word].fetch_or(mask, std::memory_order_acq_rel);
+                if ((old | mask) == full && old != full) {
+                    mark_full_(word);
+                }
+            }
+            else {
+                const u64 old = words_[word].fetch_and(~mask, std::memory_order_acq_rel);
+                if (old == full) {
+                    mark_open_(word);
+                }
+            }
+        }
+
+        // Bits [low, high] of a word.
+        static u64 range_mask_(usize low, usize high) noexcept {
+            return (full >> (word_bits - 1 - high)) & (full << low);
+        }
+    };
+
+    /*
+    * IdAllocator hands out ids in [0, capacity) without locking, backed by an AtomicBitmap.
+    * A freed id may be handed out again right away.
+    */
+    class IdAllocator {
+    private:
+        AtomicBitmap used_;
+
+    public:
+        explicit IdAllocator(usize capacity) noexcept
+            : used_{ capacity }
+        {}
+
+        // std::nullopt if every id is taken.
+        [[nodiscard]]
+        std::optional<usize> allocate() noexcept {
+            return used_.find_first_zero_and_set();
+        }
+
+        // Ids come from callers rather than from the bitmap, so the bounds check stays on in release builds.
+        void free(usize id) noexcept {
+            EH_ASSERT(id < capacity(), "Id out of range");
+            const bool was_used = used_.clear(id);
+            EH_ASSERT(was_used, "Id freed twice");
+        }
+
+        bool is_allocated(usize id) const noexcept {
+            EH_ASSERT(id < capacity(), "Id out of range");
+            return used_.test(id);
+        }
+
+        usize capacity() const noexcept {
+            return used_.size();
+        }
+
+        usize allocated() const noexcept {
+            return used_.count();
+        }
+    };
+}
@@ -0,0 +1,274 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "channel.hpp"
+#include "wait_strategy.hpp"
+
+namespace agano {
+    /*
+    * BroadcastRing<T> is a Disruptor-style single-producer ring: every published item is written once
+    * and seen by every subscribed reader. Each reader publishes its own position (gating sequence);
+    * the producer never overwrites a slot that the slowest reader has not consumed yet.
+    * All memory is allocated by the constructor, publishing and reading never allocate.
+    * Only one thread may publish at a time.
+    */
+    template<std::movable T, WaitStrategy Wait = BlockingWait>
+        requires std::default_initializable<T>
+    class BroadcastRing {
+    private:
+        static constexpr u64 inactive = std::numeric_limits<u64>::max();
+        // A reader slot that is claimed but whose start position is not known yet.
+        static constexpr u64 subscribing = inactive - 1;
+        static constexpr u64 closed_bit = u64{ 1 } << 63u;
+
+        struct alignas(cache_line_size) Sequence {
+            std::atomic<u64> value{ inactive };
+        };
+
+        std::unique_ptr<T[]> slots_;
+        u64 mask_;
+        std::unique_ptr<Sequence[]> gating_;
+        usize max_readers_;
+        Wait wait_;
+
+        alignas(cache_line_size) std::atomic<u64> published_{ 0 };
+        alignas(cache_line_size) u64 next_ = 0;
+        u64 cached_gating_ = 0;
+
+    public:
+        class Reader {
+        private:
+            BroadcastRing* ring_ = nullptr;
+            usize index_ = 0;
+            u64 next_ = 0;
+
+            friend class BroadcastRing;
+
+            Reader(BroadcastRing* ring, usize index, u64 next) noexcept
+                : ring_{ ring }
+                , index_{ index }
+                , next_{ next }
+            {}
+
+        public:
+            Reader(Reader&& rhs) noexcept
+                : ring_{ std::exchange(rhs.ring_, nullptr) }
+                , index_{ rhs.index_ }
+                , next_{ rhs.next_ }
+            {}
+
+            Reader& operator=(Reader&& rhs) noexcept {
+                if (&rhs == this) {
+                    return *this;
+                }
+
+                release_();
+                ring_ = std::exchange(rhs.ring_, nullptr);
+                index_ = rhs.index_;
+                next_ = rhs.next_;
+
+                return *this;
+            }
+
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+
+            ~Reader() noexcept {
+                release_();
+            }
+
+            // 0 for a moved-from reader.
+            usize available() const noexcept {
+                if (ring_ == nullptr) {
+                    return 0;
+                }
+                return static_cast<usize>((ring_->published_.load(std::memory_order_acquire) & ~closed_bit) - next_);
+            }
+
+            // Calls fn(const T&) for up to max items that are already published. Never blocks.
+            template<typename Fn>
+                requires std::invocable<Fn&, const T&>
+            usize try_read(Fn&& fn, usize max = std::numeric_limits<usize>::max()) noexcept {
+                EH_ASSERT(ring_ != nullptr, "Read from a moved-from reader");
+                const u64 published = ring_->published_.load(std::memory_order_acquire) & ~closed_bit;
+                return consume_(fn, published, max);
+            }
+
+            // Like try_read, but waits for at least one item. Returns 0 only once the ring is closed and drained.
+            template<typename Fn>
+                requires std::invocable<Fn&, const T&>
+            usize read(Fn&& fn, usize max = std::numeric_limits<usize>::max()) noexcept {
+                EH_ASSERT(ring_ != nullptr, "Read from a moved-from reader");
+                while (true) {
+                    const u64 published = ring_->published_.load(std::memory_order_acquire);
+                    if ((published & ~closed_bit) != next_) {
+                        return consume_(fn, published & ~closed_bit, max);
+                    }
+
+                    if ((published & closed_bit) != 0) {
+                        return 0;
+                    }
+
+                    ring_->wait_.wait(ring_->published_, published);
+                }
+            }
+
+        private:
+            template<typename Fn>
+            usize consume_(Fn& fn, u64 published, usize max) noexcept {
+                const u64 end = std::min<u64>(published, next_ + max);
+                for (u64 seq = next_; seq < end; ++seq) {
+                    fn(static_cast<const T&>(ring_->slots_[seq & ring_->mask_]));
+                }
+
+                const auto count = static_cast<usize>(end - next_);
+                if (count != 0) {
+                    next_ = end;
+                    auto& gating = ring_->gating_[index_].value;
+                    gating.store(end, std::memory_order_release);
+                    ring_->wait_.notify(gating);
+                }
+                return count;
+            }
+
+            void release_() noexcept {
+                if (ring_ != nullptr) {
+                    auto& gating = ring_->gating_[index_].value;
+                    gating.store(inactive, std::memory_order_release);
+                    ring_->wait_.notify(gating);
+                    ring_ = nullptr;
+                }
+            }
+        };
+
+        BroadcastRing(usize capacity, usize max_readers, Wait wait = {}) noexcept
+            : slots_{ std::make_unique<T[]>(std::bit_ceil(std::max<usize>(capacity, 2u))) }
+            , mask_{ std::bit_ceil(std::max<usize>(capacity, 2u)) - 1 }
+            , gating_{ std::make_unique<Sequence[]>(max_readers) }
+            , max_readers_{ max_readers }
+            , wait_{ std::move(wait) }
+        {}
+
+        BroadcastRing(BroadcastRing&&) noexcept = delete;
+        BroadcastRing& operator=(BroadcastRing&&) noexcept = delete;
+
+        BroadcastRing(const BroadcastRing&) = delete;
+        BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+        ~BroadcastRing() noexcept = default;
+
+        /*
+        * Returns a reader that sees every item published after this call,
+        * or std::nullopt when all max_readers slots are in use. The reader must not outlive the ring.
+        */
+        [[nodiscard]]
+        std::optional<Reader> subscribe() noexcept {
+            for (usize i = 0; i < max_readers_; ++i) {
+                auto& gating = gating_[i].value;
+                u64 expected = inactive;
+                // Claim the slot first; a producer that scans it now waits until the start position is stored.
+                if (!gating.compare_exchange_strong(expected, subscribing, std::memory_order_seq_cst)) {
+                    continue;
+                }
+
+                // Pairs with the fence in wait_for_capacity_: either the producer sees the claim, or this load
+                // sees every sequence its last scan allowed it to overwrite.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const u64 start = published_.load(std::memory_order_acquire) & ~closed_bit;
+                gating.store(start, std::memory_order_release);
+                wait_.notify(gating);
+                return Reader{ this, i, start };
+            }
+            return std::nullopt;
+        }
+
+        // Blocks while the slowest reader is a full ring behind.
+        void publish(T value) noexcept {
+            publish_with([&value](T& slot) { slot = std::move(value); });
+        }
+
+        // Writes the next slot in place.
+        template<typename Fn>
+            requires std::invocable<Fn&, T&>
+        void publish_with(Fn&& fill) noexcept {
+            wait_for_capacity_(next_ + 1);
+            fill(slots_[next_ & mask_]);
+            ++next_;
+            commit_();
+        }
+
+        // Publishes a whole range with one release store per ring-sized batch.
+        template<std::input_iterator It>
+        void publish(It first, It last) noexcept {
+            while (first != last) {
+                wait_for_capacity_(next_ + 1);
+
+                const u64 limit = cached_gating_ + capacity();
+                for (; first != last && next_ < limit; ++first, ++next_) {
+                    slots_[next_ & mask_] = *first;
+                }
+                commit_();
+            }
+        }
+
+        // Wakes blocked readers; they drain what is left and then read() returns 0.
+        void close() noexcept {
+            published_.fetch_or(closed_bit, std::memory_order_acq_rel);
+            wait_.notify(published_);
+        }
+
+        usize capacity() const noexcept {
+            return static_cast<usize>(mask_ + 1);
+        }
+
+    private:
+        void commit_() noexcept {
+            published_.store(next_, std::memory_order_release);
+            wait_.notify(published_);
+        }
+
+        void wait_for_capacity_(u64 end) noexcept {
+            while (cached_gating_ + capacity() < end) {
+                u64 slowest_value = next_;
+                usize slowest = max_readers_;
+                usize claimed = max_readers_;
+
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                for (usize i = 0; i < max_readers_; ++i) {
+                    const u64 value = gating_[i].value.load(std::memory_order_acquire);
+                    if (value == subscribing) {
+                        claimed = i;
+                        break;
+                    }
+
+                    if (value != inactive && value < slowest_value) {
+                        slowest_value = value;
+                        slowest = i;
+                    }
+                }
+
+                // A reader is subscribing; its start position is not known yet, so rescan once it is.
+                if (claimed != max_readers_) {
+                    wait_.wait(gating_[claimed].value, subscribing);
+                    continue;
+                }
+
+                cached_gating_ = slowest_value;
+                if (cached_gating_ + capacity() < end) {
+                    wait_.wait(gating_[slowest].value, slowest_value);
+                }
+            }
+        }
+    };
+}
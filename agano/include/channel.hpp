@@ -0,0 +1,513 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <semaphore>
+#include <stop_token>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include <fuwa/types.hpp>
+
+#include "common.hpp"
+#include "wait_strategy.hpp"
+
+namespace agano {
+    inline constexpr usize channel_max_selectors = 8u;
+
+    namespace detail {
+        // A wake-up target shared by every channel a select() call is waiting on.
+        class SelectWaiter {
+        private:
+            std::binary_semaphore semaphore_{ 0 };
+            std::atomic<bool> signaled_{ false };
+
+        public:
+            void notify() noexcept {
+                if (!signaled_.exchange(true, std::memory_order_acq_rel)) {
+                    semaphore_.release();
+                }
+            }
+
+            void wait() noexcept {
+                semaphore_.acquire();
+            }
+
+            template<typename Clock, typename Duration>
+            bool wait_until(const std::chrono::time_point<Clock, Duration>& deadline) noexcept {
+                return semaphore_.try_acquire_until(deadline);
+            }
+
+            // Only valid once the waiter is unsubscribed everywhere.
+            void reset() noexcept {
+                if (signaled_.exchange(false, std::memory_order_acq_rel)) {
+                    static_cast<void>(semaphore_.try_acquire());
+                }
+            }
+        };
+    }
+
+    /*
+    * Channel<T> is a bounded lock-free MPMC queue (a ring of sequenced cells). try_push/try_pop never block;
+    * push/pop block while the channel is full/empty, which gives producers backpressure.
+    * Blocked threads wait on an epoch counter that the other side bumps only when someone is waiting,
+    * so the uncontended path performs no wake-up calls. How they wait (park, spin, yield) is up to Wait.
+    * After close() pushes fail and pops drain what is left.
+    * close() sets the top bit of the enqueue position, so a push either claims its cell before the close and
+    * is delivered, or fails and keeps its value; consumers only report the end once every claimed cell is popped.
+    */
+    template<std::movable T, WaitStrategy Wait = BlockingWait>
+    class Channel {
+    public:
+        using value_type = T;
+
+    private:
+        // Wakes every thread waiting on the epoch; used to interrupt blocking calls on stop requests.
+        // Always notifies: a stop request is rare, and a parked waiter must see it whatever Wait is.
+        struct EpochBump {
+            std::atomic<u32>* epoch;
+
+            void operator()() const noexcept {
+                epoch->fetch_add(1, std::memory_order_seq_cst);
+                epoch->notify_all();
+            }
+        };
+
+        static constexpr usize closed_bit = usize{ 1 } << (sizeof(usize) * 8u - 1u);
+
+        struct Cell {
+            std::atomic<usize> sequence;
+            alignas(T) std::byte storage[sizeof(T)];
+
+            T* value() noexcept {
+                return std::launder(reinterpret_cast<T*>(storage));
+            }
+        };
+
+        std::unique_ptr<Cell[]> cells_;
+        usize mask_;
+
+        // closed_bit is set once the channel is closed; the other bits count claimed cells.
+        alignas(cache_line_size) std::atomic<usize> enqueue_pos_{ 0 };
+        alignas(cache_line_size) std::atomic<usize> dequeue_pos_{ 0 };
+
+        alignas(cache_line_size) std::atomic<u32> push_waiters_{ 0 };
+        std::atomic<u32> push_epoch_{ 0 };
+        std::atomic<u32> pop_waiters_{ 0 };
+        std::atomic<u32> pop_epoch_{ 0 };
+
+        std::array<std::atomic<detail::SelectWaiter*>, channel_max_selectors> selectors_{};
+        std::atomic<u32> signalling_{ 0 };
+        [[no_unique_address]] Wait wait_;
+
+    public:
+        explicit Channel(usize capacity, Wait wait = {}) noexcept
+            : cells_{ std::make_unique<Cell[]>(std::bit_ceil(std::max<usize>(capacity, 2u))) }
+            , mask_{ std::bit_ceil(std::max<usize>(capacity, 2u)) - 1 }
+            , wait_{ std::move(wait) }
+        {
+            for (usize i = 0; i <= mask_; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        Channel(Channel&&) noexcept = delete;
+        Channel& operator=(Channel&&) noexcept = delete;
+
+        Channel(const Channel&) = delete;
+        Channel& operator=(const Channel&) = delete;
+
+        ~Channel() noexcept {
+            while (try_pop_()) {}
+        }
+
+        // On failure value is left untouched.
+        [[nodiscard]]
+        bool try_push(T&& value) noexcept {
+            if (!try_push_(value)) {
+                return false;
+            }
+
+            wake_consumers_();
+            return true;
+        }
+
+        [[nodiscard]]
+        std::optional<T> try_pop() noexcept {
+            auto value = try_pop_();
+            if (value) {
+                wake_producers_();
+            }
+            return value;
+        }
+
+        // Blocks while the channel is full. Returns false if the channel is closed.
+        bool push(T&& value) noexcept {
+            return push(std::move(value), std::stop_token{});
+        }
+
+        // Also returns false, leaving value untouched, once stop is requested on token.
+        bool push(T&& value, std::stop_token token) noexcept {
+            std::optional<std::stop_callback<EpochBump>> wake;
+
+            while (true) {
+                if (is_closed() || token.stop_requested()) {
+                    return false;
+                }
+
+                if (try_push_(value)) {
+                    wake_consumers_();
+                    return true;
+                }
+
+                if (!wake && token.stop_possible()) {
+                    wake.emplace(token, EpochBump{ &push_epoch_ });
+                }
+
+                push_waiters_.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const u32 epoch = push_epoch_.load(std::memory_order_seq_cst);
+
+                if (try_push_(value)) {
+                    push_waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    wake_consumers_();
+                    return true;
+                }
+
+                if (is_closed() || token.stop_requested()) {
+                    push_waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                wait_.wait(push_epoch_, epoch);
+                push_waiters_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Blocks while the channel is empty. Returns std::nullopt once the channel is closed and drained.
+        [[nodiscard]]
+        std::optional<T> pop() noexcept {
+            return pop(std::stop_token{});
+        }
+
+        // Also returns std::nullopt once stop is requested on token.
+        [[nodiscard]]
+        std::optional<T> pop(std::stop_token token) noexcept {
+            std::optional<std::stop_callback<EpochBump>> wake;
+
+            while (true) {
+                if (auto value = try_pop()) {
+                    return value;
+                }
+
+                if (is_drained()) {
+                    return std::nullopt;
+                }
+
+                if (token.stop_requested()) {
+                    return std::nullopt;
+                }
+
+                if (!wake && token.stop_possible()) {
+                    wake.emplace(token, EpochBump{ &pop_epoch_ });
+                }
+
+                pop_waiters_.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const u32 epoch = pop_epoch_.load(std::memory_order_seq_cst);
+
+                if (auto value = try_pop_()) {
+                    pop_waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    wake_producers_();
+                    return value;
+                }
+
+                // A push that claimed its cell before close() may still be writing it; its wake-up ends this wait.
+                if (is_drained()) {
+                    pop_waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    return std::nullopt;
+                }
+
+                if (token.stop_requested()) {
+                    pop_waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    return std::nullopt;
+                }
+
+                wait_.wait(pop_epoch_, epoch);
+                pop_waiters_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        void close() noexcept {
+            enqueue_pos_.fetch_or(closed_bit, std::memory_order_seq_cst);
+
+            push_epoch_.fetch_add(1, std::memory_order_seq_cst);
+            wait_.notify(push_epoch_);
+            pop_epoch_.fetch_add(1, std::memory_order_seq_cst);
+            wait_.notify(pop_epoch_);
+            notify_selectors_();
+        }
+
+        /*
+        * Registers a select() waiter that is notified whenever an item becomes available or the channel
+        * closes. Lock-free; returns false if all channel_max_selectors slots are taken.
+        * A registered waiter counts as a blocked consumer, so channels nobody selects on never pay for it.
+        */
+        bool subscribe(detail::SelectWaiter& waiter) noexcept {
+            for (auto& slot : selectors_) {
+                detail::SelectWaiter* expected = nullptr;
+                if (slot.compare_exchange_strong(expected, &waiter, std::memory_order_seq_cst)) {
+                    pop_waiters_.fetch_add(1, std::memory_order_seq_cst);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // After this returns no producer touches the waiter anymore.
+        void unsubscribe(detail::SelectWaiter& waiter) noexcept {
+            for (auto& slot : selectors_) {
+                detail::SelectWaiter* expected = &waiter;
+                if (slot.compare_exchange_strong(expected, nullptr, std::memory_order_seq_cst)) {
+                    pop_waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    break;
+                }
+            }
+
+            while (signalling_.load(std::memory_order_seq_cst) != 0) {
+                std::this_thread::yield();
+            }
+        }
+
+        bool is_closed() const noexcept {
+            return (enqueue_pos_.load(std::memory_order_seq_cst) & closed_bit) != 0;
+        }
+
+        // True once the channel is closed and every item pushed before that has been popped.
+        bool is_drained() const noexcept {
+            const usize enqueued = enqueue_pos_.load(std::memory_order_seq_cst);
+            return (enqueued & closed_bit) != 0 && dequeue_pos_.load(std::memory_order_seq_cst) >= (enqueued & ~closed_bit);
+        }
+
+        // Approximate while other threads are pushing or popping.
+        usize size() const noexcept {
+            const usize dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+            const usize enqueued = enqueue_pos_.load(std::memory_order_relaxed) & ~closed_bit;
+            return enqueued > dequeued ? std::min(enqueued - dequeued, capacity()) : 0;
+        }
+
+        usize capacity() const noexcept {
+            return mask_ + 1;
+        }
+
+        bool empty() const noexcept {
+            const usize pos = dequeue_pos_.load(std::memory_order_acquire);
+            return cells_[pos & mask_].sequence.load(std::memory_order_acquire) != pos + 1;
+        }
+
+        bool full() const noexcept {
+            const usize pos = enqueue_pos_.load(std::memory_order_acquire) & ~closed_bit;
+            return cells_[pos & mask_].sequence.load(std::memory_order_acquire) != pos;
+        }
+
+    private:
+        // Fails once the channel is closed: the claiming CAS compares against the closed bit as well.
+        bool try_push_(T& value) noexcept {
+            usize pos = enqueue_pos_.load(std::memory_order_relaxed);
+            Cell* cell = nullptr;
+
+            while (true) {
+                if ((pos & closed_bit) != 0) {
+                    return false;
+                }
+
+                cell = &cells_[pos & mask_];
+                const auto diff = static_cast<isize>(cell->sequence.load(std::memory_order_acquire)) - static_cast<isize>(pos);
+
+                if (diff == 0) {
+                    if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;
+                }
+                else {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            std::construct_at(reinterpret_cast<T*>(cell->storage), std::move(value));
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        std::optional<T> try_pop_() noexcept {
+            usize pos = dequeue_pos_.load(std::memory_order_relaxed);
+            Cell* cell = nullptr;
+
+            while (true) {
+                cell = &cells_[pos & mask_];
+                const auto diff = static_cast<isize>(cell->sequence.load(std::memory_order_acquire)) - static_cast<isize>(pos + 1);
+
+                if (diff == 0) {
+                    if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    return std::nullopt;
+                }
+                else {
+                    pos = dequeue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            std::optional<T> value{ std::move(*cell->value()) };
+            std::destroy_at(cell->value());
+            cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+            return value;
+        }
+
+        void wake_producers_() noexcept {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (push_waiters_.load(std::memory_order_relaxed) != 0) {
+                push_epoch_.fetch_add(1, std::memory_order_seq_cst);
+                wait_.notify(push_epoch_);
+            }
+        }
+
+        void wake_consumers_() noexcept {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (pop_waiters_.load(std::memory_order_relaxed) != 0) {
+                pop_epoch_.fetch_add(1, std::memory_order_seq_cst);
+                wait_.notify(pop_epoch_);
+                notify_selectors_();
+            }
+        }
+
+        void notify_selectors_() noexcept {
+            signalling_.fetch_add(1, std::memory_order_seq_cst);
+            for (auto& slot : selectors_) {
+                if (auto* waiter = slot.load(std::memory_order_seq_cst)) {
+                    waiter->notify();
+                }
+            }
+            signalling_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    };
+
+    namespace detail {
+        template<typename C>
+        inline constexpr bool is_channel_v = false;
+
+        template<typename T, typename Wait>
+        inline constexpr bool is_channel_v<Channel<T, Wait>> = true;
+
+        inline constexpr auto select_poll_interval = std::chrono::milliseconds{ 1 };
+
+        template<usize I, typename Result, typename... Cs>
+        bool try_select_one(Result& result, std::tuple<Cs&...>& channels) noexcept {
+            if (auto value = std::get<I>(channels).try_pop()) {
+                result.template emplace<I + 1>(std::move(*value));
+                return true;
+            }
+            return false;
+        }
+
+        template<typename Result, typename... Cs, usize... Is>
+        bool try_select(Result& result, std::tuple<Cs&...>& channels, usize start, std::index_sequence<Is...>) noexcept {
+            constexpr usize count = sizeof...(Cs);
+            for (usize k = 0; k < count; ++k) {
+                const usize index = (start + k) % count;
+                if (((index == Is && try_select_one<Is>(result, channels)) || ...)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        template<typename Clock, typename Duration, typename... Cs>
+        std::variant<std::monostate, typename Cs::value_type...> select_until(const std::optional<std::chrono::time_point<Clock, Duration>>& deadline, Cs&... channels) noexcept {
+            using Result = std::variant<std::monostate, typename Cs::value_type...>;
+            constexpr auto indices = std::index_sequence_for<Cs...>{};
+
+            thread_local usize rotation = 0;
+            const usize start = rotation++;
+
+            std::tuple<Cs&...> refs{ channels... };
+            Result result;
+            SelectWaiter waiter;
+
+            while (true) {
+                if (try_select(result, refs, start, indices)) {
+                    return result;
+                }
+
+                if ((channels.is_drained() && ...)) {
+                    return result;
+                }
+
+                const bool subscribed = (static_cast<u32>(channels.subscribe(waiter)) + ...) == sizeof...(Cs);
+                const bool ready = try_select(result, refs, start, indices);
+
+                bool timed_out = false;
+                if (!ready && !(channels.is_drained() && ...)) {
+                    // Without a slot on every channel we fall back to polling.
+                    if (!subscribed) {
+                        auto poll = Clock::now() + select_poll_interval;
+                        static_cast<void>(waiter.wait_until(deadline && *deadline < poll ? *deadline : poll));
+                    }
+                    else if (deadline) {
+                        static_cast<void>(waiter.wait_until(*deadline));
+                    }
+                    else {
+                        waiter.wait();
+                    }
+                    timed_out = deadline && Clock::now() >= *deadline;
+                }
+
+                (channels.unsubscribe(waiter), ...);
+                waiter.reset();
+
+                if (ready) {
+                    return result;
+                }
+
+                if (timed_out) {
+                    try_select(result, refs, start, indices);
+                    return result;
+                }
+            }
+        }
+    }
+
+    /*
+    * Waits until any of the channels has an item and pops it. The variant index is 1 + the index of the
+    * source channel; std::monostate means that every channel is closed and drained (or select_for timed out).
+    * Channels are scanned starting at a rotating position so that no source starves the others.
+    * select() parks on a semaphore whatever the channels' wait strategies are: select_for needs a timed wait,
+    * which WaitStrategy does not offer.
+    */
+    template<typename... Cs>
+        requires (sizeof...(Cs) > 0 && (detail::is_channel_v<Cs> && ...))
+    std::variant<std::monostate, typename Cs::value_type...> select(Cs&... channels) noexcept {
+        return detail::select_until<std::chrono::steady_clock, std::chrono::steady_clock::duration>(std::nullopt, channels...);
+    }
+
+    template<typename Rep, typename Period, typename... Cs>
+        requires (sizeof...(Cs) > 0 && (detail::is_channel_v<Cs> && ...))
+    std::variant<std::monostate, typename Cs::value_type...> select_for(std::chrono::duration<Rep, Period> timeout, Cs&... channels) noexcept {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+        return detail::select_until(std::optional{ deadline }, channels...);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#if defined(__linux__)
+    #include <time.h>
+#endif
+
+#include <fuwa/types.hpp>
+
+namespace agano {
+    inline constexpr usize cache_line_size = 64u;
+
+    // Small helpers shared by several primitives; not part of the public interface.
+    namespace detail {
+        inline u64 splitmix64(u64& state) noexcept {
+            u64 z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27u)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31u);
+        }
+
+        // Per-thread pseudo-random stream, seeded from the thread's identity.
+        inline u64 thread_random() noexcept {
+            thread_local u64 state = reinterpret_cast<uintptr_t>(&state) ^ std::hash<std::thread::id>{}(std::this_thread::get_id());
+            return splitmix64(state);
+        }
+
+        // Monotonic time in nanoseconds. On Linux this is the vDSO coarse clock (a few ms of resolution, no fences).
+        inline u64 coarse_now_ns() noexcept {
+#if defined(__linux__)
+            timespec ts{};
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+            return static_cast<u64>(ts.tv_sec) * 1'000'000'000u + static_cast<u64>(ts.tv_nsec);
+#else
+            return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        // Small dense per-thread number, handed out round-robin in the order threads first ask for it.
+        // Used to spread threads over shards.
+        inline usize thread_shard_seed() noexcept {
+            static std::atomic<usize> next{ 0 };
+            thread_local const usize seed = next.fetch_add(1, std::memory_order_relaxed);
+            return seed;
+        }
+    }
+}
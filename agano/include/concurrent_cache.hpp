@@ -0,0 +1,494 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "common.hpp"
+
+namespace agano {
+    struct CacheOptions {
+        // Total weight the cache may hold, split evenly between shards.
+        usize capacity_bytes = 64u << 20u;
+        usize shard_count = 16;
+        // Time to live of entries inserted without an explicit one. Zero means they never expire.
+        std::chrono::nanoseconds default_ttl{ 0 };
+    };
+
+    struct CacheStats {
+        u64 hits = 0;
+        u64 misses = 0;
+        u64 evictions = 0;
+        u64 expirations = 0;
+        usize entries = 0;
+        usize bytes = 0;
+    };
+
+    // Charges every entry with the in-place size of its key and value.
+    struct SizeofWeigher {
+        template<typename K, typename V>
+        usize operator()(const K&, const V&) const noexcept {
+            return sizeof(K) + sizeof(V);
+        }
+    };
+
+    /*
+    * ConcurrentCache is a sharded cache with CLOCK (second chance) eviction and a lock-free read path.
+    * Every shard is an open-addressing table of pointers to immutable entries. get() takes no lock: it
+    * registers in a reader slot, probes the table and copies the value out; a hit only sets the entry's
+    * reference bit. Writers serialize per shard, swap entry pointers in and out of the table and sweep the
+    * clock hand: referenced entries lose their bit and survive one more round, unreferenced or expired ones
+    * are evicted until the new entry fits. Capacity is a weight budget (bytes by default, see Weigher);
+    * expiry is checked lazily against a coarse clock.
+    *
+    * Unlinked entries and outgrown tables are freed with epoch-based reclamation: readers count themselves
+    * in one of two counters of their slot, picked by the parity of a global epoch, and a writer only frees
+    * what was unlinked two epochs ago. The epoch advances once nobody is left in the previous one, so a
+    * reader that stalls inside get() delays reclamation, not other readers or writers. Table pointers, slots,
+    * reader counters and the epoch are all accessed seq_cst: a reader can only reach an entry if its epoch check
+    * precedes the unlink in the single total order, and then one of the two advances before the free sees it.
+    * Reader slots are striped by thread and also hold the hit and miss counters, so concurrent lookups of
+    * the same hot key write only to their own cache lines.
+    */
+    template<
+        std::copy_constructible K,
+        std::copy_constructible V,
+        typename Hash = std::hash<K>,
+        typename Eq = std::equal_to<K>,
+        typename Weigher = SizeofWeigher
+    >
+        requires std::invocable<const Weigher&, const K&, const V&>
+    class ConcurrentCache {
+    private:
+        struct Entry {
+            u64 hash;
+            K key;
+            V value;
+            usize weight;
+            // Coarse clock deadline in ns, zero if the entry never expires.
+            u64 expires_at;
+            // Set by hits, cleared by the clock hand.
+            mutable std::atomic<bool> referenced{ false };
+        };
+
+        struct Table {
+            usize mask;
+            std::unique_ptr<std::atomic<Entry*>[]> slots;
+        };
+
+        struct alignas(cache_line_size) ReaderSlot {
+            std::atomic<u64> active[2]{};
+            std::atomic<u64> hits{ 0 };
+            std::atomic<u64> misses{ 0 };
+        };
+
+        struct alignas(cache_line_size) Shard {
+            // The only field readers touch, kept off the writer's cache line.
+            std::atomic<Table*> table{ nullptr };
+
+            alignas(cache_line_size) std::mutex mutex;
+            // Occupied slots, and occupied plus erased (tombstone) ones.
+            usize live = 0;
+            usize used = 0;
+            usize hand = 0;
+            usize bytes = 0;
+            std::deque<std::pair<u64, Entry*>> retired_entries;
+            std::deque<std::pair<u64, Table*>> retired_tables;
+
+            std::atomic<u64> evictions{ 0 };
+            std::atomic<u64> expirations{ 0 };
+        };
+
+        static constexpr usize npos = static_cast<usize>(-1);
+        static constexpr usize min_table_size = 16u;
+        static constexpr usize reader_slot_count = 64u;
+
+        std::unique_ptr<Shard[]> shards_;
+        usize shard_count_;
+        usize shard_capacity_;
+        std::chrono::nanoseconds default_ttl_;
+        Hash hash_;
+        [[no_unique_address]] Eq eq_;
+        Weigher weigher_;
+
+        std::unique_ptr<ReaderSlot[]> readers_;
+        alignas(cache_line_size) std::atomic<u64> epoch_{ 0 };
+
+        // Registers the calling thread as a reader until it goes out of scope.
+        class ReadGuard {
+        private:
+            ReaderSlot& slot_;
+            std::atomic<u64>* active_ = nullptr;
+
+        public:
+            explicit ReadGuard(ReaderSlot& slot, const std::atomic<u64>& epoch) noexcept
+                : slot_{ slot }
+            {
+                // Only count in an epoch that is still current once the count is visible, so a writer that
+                // advanced past it has either seen us or we retry in the new one.
+                while (true) {
+                    const u64 current = epoch.load(std::memory_order_seq_cst);
+                    active_ = &slot_.active[current & 1u];
+                    active_->fetch_add(1, std::memory_order_seq_cst);
+                    if (epoch.load(std::memory_order_seq_cst) == current) {
+                        return;
+                    }
+                    active_->fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+
+            ReadGuard(ReadGuard&&) noexcept = delete;
+            ReadGuard& operator=(ReadGuard&&) noexcept = delete;
+
+            ReadGuard(const ReadGuard&) = delete;
+            ReadGuard& operator=(const ReadGuard&) = delete;
+
+            ~ReadGuard() noexcept {
+                active_->fetch_sub(1, std::memory_order_release);
+            }
+
+            ReaderSlot& slot() const noexcept {
+                return slot_;
+            }
+        };
+
+    public:
+        explicit ConcurrentCache(CacheOptions options = {}, Hash hash = Hash{}, Weigher weigher = Weigher{}) noexcept
+            : shards_{ std::make_unique<Shard[]>(std::max<usize>(options.shard_count, 1u)) }
+            , shard_count_{ std::max<usize>(options.shard_count, 1u) }
+            , shard_capacity_{ options.capacity_bytes / std::max<usize>(options.shard_count, 1u) }
+            , default_ttl_{ options.default_ttl }
+            , hash_{ std::move(hash) }
+            , weigher_{ std::move(weigher) }
+            , readers_{ std::make_unique<ReaderSlot[]>(reader_slot_count) }
+        {
+            EH_ASSERT(shard_capacity_ > 0, "Cache capacity is smaller than the shard count");
+            for (usize i = 0; i < shard_count_; ++i) {
+                shards_[i].table.store(make_table_(min_table_size), std::memory_order_relaxed);
+            }
+        }
+
+        ConcurrentCache(ConcurrentCache&&) noexcept = delete;
+        ConcurrentCache& operator=(ConcurrentCache&&) noexcept = delete;
+
+        ConcurrentCache(const ConcurrentCache&) = delete;
+        ConcurrentCache& operator=(const ConcurrentCache&) = delete;
+
+        ~ConcurrentCache() noexcept {
+            for (usize i = 0; i < shard_count_; ++i) {
+                Shard& shard = shards_[i];
+                free_table_(shard.table.load(std::memory_order_relaxed), true);
+                for (auto& [epoch, entry] : shard.retired_entries) {
+                    delete entry;
+                }
+                for (auto& [epoch, table] : shard.retired_tables) {
+                    free_table_(table, false);
+                }
+            }
+        }
+
+        // A copy of the cached value, or std::nullopt on a miss or if the entry has expired.
+        std::optional<V> get(const K& key) const noexcept {
+            const u64 hash = hash_of_(key);
+            const Shard& shard = shard_for_(hash);
+            ReadGuard guard{ reader_slot_(), epoch_ };
+
+            const Entry* entry = probe_(*shard.table.load(std::memory_order_seq_cst), hash, key).second;
+            if (entry == nullptr || expired_(*entry, detail::coarse_now_ns())) {
+                guard.slot().misses.fetch_add(1, std::memory_order_relaxed);
+                return std::nullopt;
+            }
+
+            // Skip the store when the bit is already set, so hot entries do not bounce their cache line.
+            if (!entry->referenced.load(std::memory_order_relaxed)) {
+                entry->referenced.store(true, std::memory_order_relaxed);
+            }
+            guard.slot().hits.fetch_add(1, std::memory_order_relaxed);
+            return entry->value;
+        }
+
+        bool contains(const K& key) const noexcept {
+            const u64 hash = hash_of_(key);
+            const Shard& shard = shard_for_(hash);
+            ReadGuard guard{ reader_slot_(), epoch_ };
+
+            const Entry* entry = probe_(*shard.table.load(std::memory_order_seq_cst), hash, key).second;
+            return entry != nullptr && !expired_(*entry, detail::coarse_now_ns());
+        }
+
+        // Inserts or replaces the entry for key with the default TTL. Returns false if it weighs more than a whole shard.
+        bool insert(K key, V value) noexcept {
+            return insert(std::move(key), std::move(value), default_ttl_);
+        }
+
+        // Same as insert(key, value), with its own TTL; zero means it never expires.
+        bool insert(K key, V value, std::chrono::nanoseconds ttl) noexcept {
+            const usize weight = std::invoke(weigher_, std::as_const(key), std::as_const(value));
+            if (weight > shard_capacity_) {
+                return false;
+            }
+
+            const u64 now = detail::coarse_now_ns();
+            const u64 hash = hash_of_(key);
+            auto* entry = new Entry{ hash, std::move(key), std::move(value), weight, ttl.count() > 0 ? now + static_cast<u64>(ttl.count()) : 0 };
+
+            Shard& shard = shard_for_(hash);
+            std::lock_guard lock{ shard.mutex };
+
+            const auto [existing, replaced] = probe_(*shard.table.load(std::memory_order_relaxed), hash, entry->key);
+            const usize replaced_weight = replaced != nullptr ? replaced->weight : 0;
+            while (shard.bytes - replaced_weight + weight > shard_capacity_) {
+                evict_one_(shard, now, existing);
+            }
+
+            // Evicting never rebuilds the table, so the slot of the replaced entry is still valid.
+            Table* table = shard.table.load(std::memory_order_relaxed);
+            if (existing != npos) {
+                Entry* old = table->slots[existing].exchange(entry, std::memory_order_seq_cst);
+                shard.bytes -= old->weight;
+                retire_(shard, old);
+            }
+            else {
+                if ((shard.used + 1) * 2 > table->mask + 1) {
+                    table = rebuild_(shard);
+                }
+
+                usize index = static_cast<usize>(std::rotr(hash, 32)) & table->mask;
+                while (true) {
+                    Entry* current = table->slots[index].load(std::memory_order_relaxed);
+                    if (current == nullptr || current == tombstone_()) {
+                        shard.used += current == nullptr ? 1u : 0u;
+                        break;
+                    }
+                    index = (index + 1) & table->mask;
+                }
+                table->slots[index].store(entry, std::memory_order_seq_cst);
+                ++shard.live;
+            }
+
+            shard.bytes += weight;
+            reclaim_(shard);
+            return true;
+        }
+
+        // Returns false if there was no entry for key.
+        bool erase(const K& key) noexcept {
+            const u64 hash = hash_of_(key);
+            Shard& shard = shard_for_(hash);
+            std::lock_guard lock{ shard.mutex };
+
+            const usize index = probe_(*shard.table.load(std::memory_order_relaxed), hash, key).first;
+            if (index == npos) {
+                return false;
+            }
+            remove_(shard, index);
+            reclaim_(shard);
+            return true;
+        }
+
+        void clear() noexcept {
+            for (usize i = 0; i < shard_count_; ++i) {
+                Shard& shard = shards_[i];
+                std::lock_guard lock{ shard.mutex };
+
+                Table* old = shard.table.exchange(make_table_(min_table_size), std::memory_order_seq_cst);
+                for (usize slot = 0; slot <= old->mask; ++slot) {
+                    Entry* entry = old->slots[slot].load(std::memory_order_relaxed);
+                    if (entry != nullptr && entry != tombstone_()) {
+                        retire_(shard, entry);
+                    }
+                }
+                shard.retired_tables.emplace_back(epoch_.load(std::memory_order_seq_cst), old);
+                shard.live = 0;
+                shard.used = 0;
+                shard.hand = 0;
+                shard.bytes = 0;
+                reclaim_(shard);
+            }
+        }
+
+        // Sums the counters and sizes of all shards; each shard is read under its own lock, not all at once.
+        CacheStats stats() const noexcept {
+            CacheStats stats{};
+            for (usize i = 0; i < reader_slot_count; ++i) {
+                stats.hits += readers_[i].hits.load(std::memory_order_relaxed);
+                stats.misses += readers_[i].misses.load(std::memory_order_relaxed);
+            }
+
+            for (usize i = 0; i < shard_count_; ++i) {
+                Shard& shard = shards_[i];
+                stats.evictions += shard.evictions.load(std::memory_order_relaxed);
+                stats.expirations += shard.expirations.load(std::memory_order_relaxed);
+
+                std::lock_guard lock{ shard.mutex };
+                stats.entries += shard.live;
+                stats.bytes += shard.bytes;
+            }
+            return stats;
+        }
+
+        usize capacity_bytes() const noexcept {
+            return shard_capacity_ * shard_count_;
+        }
+
+        usize shard_count() const noexcept {
+            return shard_count_;
+        }
+
+    private:
+        static Entry* tombstone_() noexcept {
+            // Marks an erased slot so probes continue past it; never dereferenced.
+            static constinit char marker = 0;
+            return reinterpret_cast<Entry*>(&marker);
+        }
+
+        static Table* make_table_(usize size) noexcept {
+            return new Table{ size - 1, std::make_unique<std::atomic<Entry*>[]>(size) };
+        }
+
+        static void free_table_(Table* table, bool with_entries) noexcept {
+            if (with_entries) {
+                for (usize i = 0; i <= table->mask; ++i) {
+                    Entry* entry = table->slots[i].load(std::memory_order_relaxed);
+                    if (entry != nullptr && entry != tombstone_()) {
+                        delete entry;
+                    }
+                }
+            }
+            delete table;
+        }
+
+        u64 hash_of_(const K& key) const noexcept {
+            // Remix the hash: neither the shard nor the table slot may depend on the quality of Hash.
+            u64 state = static_cast<u64>(hash_(key));
+            return detail::splitmix64(state);
+        }
+
+        Shard& shard_for_(u64 hash) const noexcept {
+            return shards_[hash % shard_count_];
+        }
+
+        ReaderSlot& reader_slot_() const noexcept {
+            return readers_[detail::thread_shard_seed() % reader_slot_count];
+        }
+
+        // Slot and entry of key in table, or npos and nullptr. Safe for readers: a slot only ever changes from one
+        // whole entry (or tombstone) to another, and the entry returned is the one that was compared.
+        std::pair<usize, Entry*> probe_(const Table& table, u64 hash, const K& key) const noexcept {
+            usize index = static_cast<usize>(std::rotr(hash, 32)) & table.mask;
+            while (true) {
+                Entry* entry = table.slots[index].load(std::memory_order_seq_cst);
+                if (entry == nullptr) {
+                    return { npos, nullptr };
+                }
+                if (entry != tombstone_() && entry->hash == hash && eq_(entry->key, key)) {
+                    return { index, entry };
+                }
+                index = (index + 1) & table.mask;
+            }
+        }
+
+        static bool expired_(const Entry& entry, u64 now) noexcept {
+            return entry.expires_at != 0 && entry.expires_at <= now;
+        }
+
+        void retire_(Shard& shard, Entry* entry) noexcept {
+            shard.retired_entries.emplace_back(epoch_.load(std::memory_order_seq_cst), entry);
+        }
+
+        void remove_(Shard& shard, usize index) noexcept {
+            Entry* entry = shard.table.load(std::memory_order_relaxed)->slots[index].exchange(tombstone_(), std::memory_order_seq_cst);
+            shard.bytes -= entry->weight;
+            --shard.live;
+            retire_(shard, entry);
+        }
+
+        // Moves the live entries to a table with room to grow and drops the tombstones.
+        Table* rebuild_(Shard& shard) noexcept {
+            Table* old = shard.table.load(std::memory_order_relaxed);
+            Table* table = make_table_(std::max(min_table_size, std::bit_ceil((shard.live + 1) * 4)));
+            for (usize i = 0; i <= old->mask; ++i) {
+                Entry* entry = old->slots[i].load(std::memory_order_relaxed);
+                if (entry == nullptr || entry == tombstone_()) {
+                    continue;
+                }
+
+                usize index = static_cast<usize>(std::rotr(entry->hash, 32)) & table->mask;
+                while (table->slots[index].load(std::memory_order_relaxed) != nullptr) {
+                    index = (index + 1) & table->mask;
+                }
+                table->slots[index].store(entry, std::memory_order_relaxed);
+            }
+
+            shard.table.store(table, std::memory_order_seq_cst);
+            shard.retired_tables.emplace_back(epoch_.load(std::memory_order_seq_cst), old);
+            shard.used = shard.live;
+            shard.hand = 0;
+            return table;
+        }
+
+        // Advances the epoch if no reader is left in the previous one and returns the current epoch.
+        u64 try_advance_() noexcept {
+            u64 epoch = epoch_.load(std::memory_order_seq_cst);
+            for (usize i = 0; i < reader_slot_count; ++i) {
+                if (readers_[i].active[(epoch + 1) & 1u].load(std::memory_order_seq_cst) != 0) {
+                    return epoch;
+                }
+            }
+            return epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst) ? epoch + 1 : epoch;
+        }
+
+        // Frees what was unlinked at least two epochs ago: every reader that could still see it has left.
+        void reclaim_(Shard& shard) noexcept {
+            if (shard.retired_entries.empty() && shard.retired_tables.empty()) {
+                return;
+            }
+
+            const u64 epoch = try_advance_();
+            while (!shard.retired_entries.empty() && shard.retired_entries.front().first + 2 <= epoch) {
+                delete shard.retired_entries.front().second;
+                shard.retired_entries.pop_front();
+            }
+            while (!shard.retired_tables.empty() && shard.retired_tables.front().first + 2 <= epoch) {
+                free_table_(shard.retired_tables.front().second, false);
+                shard.retired_tables.pop_front();
+            }
+        }
+
+        // Advances the hand to the first expired or unreferenced entry other than the one at `keep` and evicts it.
+        // Terminates within two sweeps because every referenced entry it passes loses its bit. Besides `keep`,
+        // the shard must not be empty.
+        void evict_one_(Shard& shard, u64 now, usize keep) noexcept {
+            Table& table = *shard.table.load(std::memory_order_relaxed);
+            EH_ASSERT(shard.live > (keep != npos ? 1u : 0u), "Nothing to evict");
+            while (true) {
+                const usize index = shard.hand;
+                shard.hand = (shard.hand + 1) & table.mask;
+
+                const Entry* entry = table.slots[index].load(std::memory_order_relaxed);
+                if (entry == nullptr || entry == tombstone_() || index == keep) {
+                    continue;
+                }
+
+                const bool expired = expired_(*entry, now);
+                if (!expired && entry->referenced.exchange(false, std::memory_order_relaxed)) {
+                    continue;
+                }
+
+                (expired ? shard.expirations : shard.evictions).fetch_add(1, std::memory_order_relaxed);
+                remove_(shard, index);
+                return;
+            }
+        }
+    };
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "common.hpp"
+
+namespace agano {
+    /*
+    * ConcurrentVector<T> is an append-only vector that many threads can push to and read from at once.
+    * Storage is a list of segments of first_segment_size, 2x, 4x, ... elements, so elements never move
+    * and references stay valid. Appending reserves indices with one fetch_add, allocates a missing
+    * segment with a CAS, constructs the element and then marks it published; get() only returns
+    * published elements. Elements are destroyed together with the vector.
+    */
+    template<std::movable T>
+    class ConcurrentVector {
+    private:
+        struct Slot {
+            std::atomic<bool> ready{ false };
+            alignas(T) std::byte storage[sizeof(T)];
+
+            T* get() noexcept {
+                return std::launder(reinterpret_cast<T*>(storage));
+            }
+        };
+
+        static constexpr usize first_segment_bits = 5u;
+        static constexpr usize max_segments = 64u - first_segment_bits;
+
+        std::array<std::atomic<Slot*>, max_segments> segments_{};
+        alignas(cache_line_size) std::atomic<usize> size_{ 0 };
+
+    public:
+        static constexpr usize first_segment_size = usize{ 1 } << first_segment_bits;
+
+        ConcurrentVector() noexcept = default;
+
+        ConcurrentVector(ConcurrentVector&&) noexcept = delete;
+        ConcurrentVector& operator=(ConcurrentVector&&) noexcept = delete;
+
+        ConcurrentVector(const ConcurrentVector&) = delete;
+        ConcurrentVector& operator=(const ConcurrentVector&) = delete;
+
+        ~ConcurrentVector() noexcept {
+            const usize size = size_.load(std::memory_order_acquire);
+            for (usize segment = 0; segment < max_segments; ++segment) {
+                Slot* slots = segments_[segment].load(std::memory_order_acquire);
+                if (slots == nullptr) {
+                    continue;
+                }
+
+                const usize first = segment_start_(segment);
+                for (usize i = 0; i < segment_size_(segment) && first + i < size; ++i) {
+                    if (slots[i].ready.load(std::memory_order_acquire)) {
+                        slots[i].get()->~T();
+                    }
+                }
+                delete[] slots;
+            }
+        }
+
+        // Returns the index of the new element.
+        template<typename... Args>
+            requires std::constructible_from<T, Args...>
+        usize emplace_back(Args&&... args) noexcept {
+            const usize index = size_.fetch_add(1, std::memory_order_relaxed);
+            construct_(index, std::forward<Args>(args)...);
+            return index;
+        }
+
+        usize push_back(T value) noexcept {
+            return emplace_back(std::move(value));
+        }
+
+        // Appends n copies of value and returns the index of the first one.
+        usize grow_by(usize n, const T& value) noexcept requires std::copy_constructible<T> {
+            const usize first = size_.fetch_add(n, std::memory_order_relaxed);
+            for (usize i = 0; i < n; ++i) {
+                construct_(first + i, value);
+            }
+            return first;
+        }
+
+        // Appends n default-constructed elements and returns the index of the first one.
+        usize grow_by(usize n) noexcept requires std::default_initializable<T> {
+            const usize first = size_.fetch_add(n, std::memory_order_relaxed);
+            for (usize i = 0; i < n; ++i) {
+                construct_(first + i);
+            }
+            return first;
+        }
+
+        // nullptr if the element at index has not been published yet.
+        const T* get(usize index) const noexcept {
+            Slot* slot = find_(index);
+            return slot != nullptr && slot->ready.load(std::memory_order_acquire) ? slot->get() : nullptr;
+        }
+
+        T* get(usize index) noexcept {
+            Slot* slot = find_(index);
+            return slot != nullptr && slot->ready.load(std::memory_order_acquire) ? slot->get() : nullptr;
+        }
+
+        // The element must already be published, e.g. its index came back from push_back() on this thread.
+        const T& operator[](usize index) const noexcept {
+            const T* element = get(index);
+            EH_ASSERT(element != nullptr, "Element is not published yet");
+            return *element;
+        }
+
+        T& operator[](usize index) noexcept {
+            T* element = get(index);
+            EH_ASSERT(element != nullptr, "Element is not published yet");
+            return *element;
+        }
+
+        // Number of reserved indices; the newest ones may still be under construction.
+        usize size() const noexcept {
+            return size_.load(std::memory_order_acquire);
+        }
+
+        bool empty() const noexcept {
+            return size() == 0;
+        }
+
+        // Calls fn(index, element) for every element published so far, in index order.
+        template<typename Fn>
+            requires std::invocable<Fn&, usize, const T&>
+        void for_each(Fn&& fn) const noexcept {
+            const usize size = size_.load(std::memory_order_acquire);
+            for (usize i = 0; i < size; ++i) {
+                if (const T* element = get(i)) {
+                    fn(i, *element);
+                }
+            }
+        }
+
+    private:
+        static usize segment_of_(usize index) noexcept {
+            return static_cast<usize>(std::bit_width((index >> first_segment_bits) + 1u)) - 1u;
+        }
+
+        static usize segment_start_(usize segment) noexcept {
+            return ((usize{ 1 } << segment) - 1u) << first_segment_bits;
+        }
+
+        static usize segment_size_(usize segment) noexcept {
+            return first_segment_size << segment;
+        }
+
+        Slot* find_(usize index) const noexcept {
+            const usize segment = segment_of_(index);
+            if (segment >= max_segments) {
+                return nullptr;
+            }
+
+            Slot* slots = segments_[segment].load(std::memory_order_acquire);
+            return slots != nullptr ? slots + (index - segment_start_(segment)) : nullptr;
+        }
+
+        Slot* segment_for_(usize segment) noexcept {
+            EH_ASSERT(segment < max_segments, "ConcurrentVector is full");
+
+            Slot* slots = segments_[segment].load(std::memory_order_acquire);
+            if (slots != nullptr) {
+                return slots;
+            }
+
+            // Several threads may race to allocate the same segment; the losers free theirs.
+            auto* fresh = new Slot[segment_size_(segment)];
+            if (segments_[segment].compare_exchange_strong(slots, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return fresh;
+            }
+            delete[] fresh;
+            return slots;
+        }
+
+        template<typename... Args>
+        void construct_(usize index, Args&&... args) noexcept {
+            const usize segment = segment_of_(index);
+            Slot& slot = segment_for_(segment)[index - segment_start_(segment)];
+            new (slot.storage) T(std::forward<Args>(args)...);
+            slot.ready.store(true, std::memory_order_release);
+        }
+    };
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <atomic>
+#include <concepts>
+#include <utility>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "agano.hpp"
+#include "arc.hpp"
+
+namespace agano {
+    /*
+    * Cow<T> is an Arc<T> that can also be written: a shared handle to a heap-allocated T with an atomic
+    * reference count. Copying a Cow only bumps the count. make_mut() returns a mutable reference, cloning the value
+    * first if any other handle still points to it, so readers holding a copy never see the change.
+    * A moved-from Cow is empty and must be assigned before use.
+    */
+    template<std::copy_constructible T>
+    class Cow {
+    private:
+        Arc<T> arc_;
+
+        explicit Cow(Arc<T> arc) noexcept
+            : arc_{ std::move(arc) }
+        {}
+
+        template<std::copy_constructible U, typename... Args>
+        friend Cow<U> make_cow(Args&&... args) noexcept;
+
+    public:
+        Cow() noexcept requires std::default_initializable<T>
+            : arc_{ make_arc<T>() }
+        {}
+
+        Cow(T&& value) noexcept
+            : arc_{ make_arc<T>(std::move(value)) }
+        {}
+
+        Cow(const Cow&) noexcept = default;
+        Cow& operator=(const Cow&) noexcept = default;
+
+        Cow(Cow&&) noexcept = default;
+        Cow& operator=(Cow&&) noexcept = default;
+
+        ~Cow() noexcept = default;
+
+        const T* operator->() const noexcept {
+            EH_ASSERT(arc_, "Access to a moved-from Cow");
+            return arc_.get();
+        }
+
+        const T& operator*() const noexcept {
+            EH_ASSERT(arc_, "Access to a moved-from Cow");
+            return *arc_;
+        }
+
+        // Clones the value if it is shared, then returns it for writing.
+        T& make_mut() noexcept {
+            EH_ASSERT(arc_, "Access to a moved-from Cow");
+
+            if (!is_unique()) {
+                arc_ = make_arc<T>(std::as_const(*arc_));
+            }
+            return arc_.block_->value;
+        }
+
+        // Exact only when no other thread is copying or dropping handles to the same value.
+        usize use_count() const noexcept {
+            return arc_ ? static_cast<usize>(arc_.block_->refs.load(std::memory_order_relaxed)) : 0;
+        }
+
+        bool is_unique() const noexcept {
+            // acquire pairs with the release decrement of handles that were dropped, so their reads are done.
+            return arc_ && arc_.block_->refs.load(std::memory_order_acquire) == 1;
+        }
+
+        bool is_empty() const noexcept {
+            return !arc_;
+        }
+
+        // True if both handles share the same value.
+        bool same_as(const Cow& rhs) const noexcept {
+            return arc_.same_as(rhs.arc_);
+        }
+
+        // A read-only handle to the current value, e.g. to publish it through an AtomicArc.
+        [[nodiscard]]
+        Arc<T> share() const noexcept {
+            return arc_;
+        }
+
+        void swap(Cow& rhs) noexcept {
+            arc_.swap(rhs.arc_);
+        }
+    };
+
+    template<std::copy_constructible T, typename... Args>
+    Cow<T> make_cow(Args&&... args) noexcept {
+        return Cow<T>{ make_arc<T>(std::forward<Args>(args)...) };
+    }
+
+    /*
+    * Returns the current value of a Synced<Cow<T>>. The lock is held only to bump the reference count,
+    * so many readers can take consistent snapshots while a writer prepares the next version.
+    */
+    template<typename T, Mutex M> requires Send<Cow<T>>
+    [[nodiscard]]
+    Cow<T> snapshot(Synced<Cow<T>, M>& synced) noexcept {
+        return *synced.lock();
+    }
+
+    // Replaces the value of a Synced<Cow<T>>; the old value is released after the lock is dropped.
+    template<typename T, Mutex M> requires Send<Cow<T>>
+    void publish(Synced<Cow<T>, M>& synced, Cow<T> value) noexcept {
+        synced.lock()->swap(value);
+    }
+
+    // A Cow is an Arc with value semantics on top, so it crosses threads exactly when its Arc does.
+    template<typename T> requires Send<Arc<T>>
+    inline constexpr bool send_tag_v<Cow<T>> = true;
+
+    template<typename T> requires Sync<Arc<T>>
+    inline constexpr bool send_tag_v<const Cow<T>&> = true;
+}
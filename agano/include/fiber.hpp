@@ -0,0 +1,150 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fuwa/types.hpp>
+
+#include "agano.hpp"
+#include "thread_pool.hpp"
+
+// Context switches are hand-written for the System V x86-64 and AArch64 ELF ABIs.
+#if defined(__ELF__) && (defined(__x86_64__) || defined(__aarch64__))
+    #define AGANO_HAS_FIBERS 1
+#else
+    #define AGANO_HAS_FIBERS 0
+#endif
+
+#if AGANO_HAS_FIBERS
+namespace agano {
+    inline constexpr usize default_fiber_stack_size = 256u * 1024u;
+
+    namespace detail {
+        struct Fiber;
+
+        // mmap-ed stack with a PROT_NONE guard page below its lowest usable address.
+        struct FiberStack {
+            void* base = nullptr;
+            usize size = 0;
+        };
+
+        class StackPool {
+        private:
+            std::mutex mutex_;
+            std::vector<FiberStack> free_;
+            usize stack_size_;
+
+        public:
+            static constexpr usize max_cached = 1024u;
+
+            explicit StackPool(usize stack_size) noexcept;
+            ~StackPool() noexcept;
+
+            StackPool(StackPool&&) noexcept = delete;
+            StackPool& operator=(StackPool&&) noexcept = delete;
+
+            StackPool(const StackPool&) = delete;
+            StackPool& operator=(const StackPool&) = delete;
+
+            FiberStack acquire() noexcept;
+            void release(FiberStack stack) noexcept;
+        };
+    }
+
+    /*
+    * FiberScheduler runs stackful fibers M:N on a fixed set of worker threads. A fiber runs until it finishes,
+    * calls this_fiber::yield() or blocks on a fiber-aware primitive such as FiberMutex; in the last two cases
+    * the worker picks up another fiber and the suspended one may later resume on a different worker.
+    * Stacks come from a pool of guard-paged stacks and are reused when fibers finish.
+    */
+    class FiberScheduler {
+    private:
+        detail::StackPool stacks_;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<detail::Fiber*> ready_;
+        bool stopping_ = false;
+
+        usize live_ = 0;
+        std::condition_variable idle_cv_;
+
+        std::vector<std::thread> workers_;
+
+        friend class FiberMutex;
+
+    public:
+        explicit FiberScheduler(usize thread_count = std::max(std::thread::hardware_concurrency(), 1u), usize stack_size = default_fiber_stack_size) noexcept;
+
+        FiberScheduler(FiberScheduler&&) noexcept = delete;
+        FiberScheduler& operator=(FiberScheduler&&) noexcept = delete;
+
+        FiberScheduler(const FiberScheduler&) = delete;
+        FiberScheduler& operator=(const FiberScheduler&) = delete;
+
+        // Waits for every fiber to finish.
+        ~FiberScheduler() noexcept;
+
+        template<Task F>
+        void spawn(F&& fn) noexcept {
+            spawn_(UniqueTask{ std::forward<F>(fn) });
+        }
+
+        // Blocks the calling thread (which must not be a fiber) until no fibers are left.
+        void wait_idle() noexcept;
+
+    private:
+        void spawn_(UniqueTask fn) noexcept;
+        void schedule_(detail::Fiber* fiber) noexcept;
+        void worker_loop_() noexcept;
+    };
+
+    namespace this_fiber {
+        bool is_fiber() noexcept;
+
+        // Lets other fibers run. Outside of a fiber this is std::this_thread::yield().
+        void yield() noexcept;
+    }
+
+    /*
+    * FiberMutex satisfies agano::Mutex. A fiber that finds it locked is suspended and its worker thread
+    * runs other fibers; unlock() hands the mutex straight to the first waiting fiber.
+    * Plain threads may use it too, they spin and yield. Use it through FiberSynced<T>.
+    */
+    class FiberMutex {
+    private:
+        std::atomic<bool> locked_{ false };
+        std::atomic_flag guard_;
+        detail::Fiber* head_ = nullptr;
+        detail::Fiber* tail_ = nullptr;
+
+    public:
+        FiberMutex() noexcept = default;
+
+        FiberMutex(FiberMutex&&) noexcept = delete;
+        FiberMutex& operator=(FiberMutex&&) noexcept = delete;
+
+        FiberMutex(const FiberMutex&) = delete;
+        FiberMutex& operator=(const FiberMutex&) = delete;
+
+        ~FiberMutex() noexcept = default;
+
+        bool try_lock() noexcept {
+            bool expected = false;
+            return locked_.compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        void lock() noexcept;
+        void unlock() noexcept;
+    };
+
+    // Synced whose lock() suspends the calling fiber instead of blocking its worker thread.
+    // lock_when() still blocks the thread, so prefer lock() + this_fiber::yield() loops inside fibers.
+    template<Send T>
+    using FiberSynced = Synced<T, FiberMutex>;
+}
+#endif
@@ -0,0 +1,185 @@
+#pragma once
+#include <algorithm>
+#include <coroutine>
+#include <cstring>
+#include <format>
+#include <future>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <fuwa/types.hpp>
+#include <fuwa/result.hpp>
+
+// The service relies on POSIX file descriptors; io_uring itself is only used on Linux.
+#if defined(__unix__) || defined(__APPLE__)
+    #define AGANO_HAS_IO_SERVICE 1
+#else
+    #define AGANO_HAS_IO_SERVICE 0
+#endif
+
+#if AGANO_HAS_IO_SERVICE
+namespace agano {
+    // Carries a raw errno value.
+    enum class IoError : i32 {
+        eNone = 0,
+    };
+}
+
+template<>
+struct eh::ErrorTypeTrait<agano::IoError> {
+    static std::string_view description(agano::IoError error) noexcept {
+        return std::strerror(static_cast<i32>(error));
+    }
+
+    static std::string stringify(agano::IoError error) noexcept {
+        return std::format("errno {}", static_cast<i32>(error));
+    }
+
+    static agano::IoError default_value() noexcept {
+        return agano::IoError::eNone;
+    }
+};
+
+namespace agano {
+    // Bytes transferred for read/write, the new descriptor for open, 0 for fsync.
+    using IoResult = eh::Result<i32, IoError>;
+
+    enum class IoBackend {
+        eAuto = 0,
+        eIoUring,
+        eThreadPool,
+    };
+
+    namespace detail {
+        enum class IoOpcode {
+            eRead = 0,
+            eWrite,
+            eFsync,
+            eOpen,
+        };
+
+        // One request. complete() is called exactly once with the result (negative errno on failure).
+        struct IoOp {
+            IoOpcode opcode = IoOpcode::eRead;
+            i32 fd = -1;
+            void* buffer = nullptr;
+            u32 length = 0;
+            u64 offset = 0;
+            std::string path{};
+            i32 flags = 0;
+            u32 mode = 0;
+            void (*complete)(IoOp*, i32) noexcept = nullptr;
+        };
+
+        inline IoResult to_io_result(i32 result) noexcept {
+            if (result < 0) {
+                return eh::Error<IoError>{ static_cast<IoError>(-result) };
+            }
+            return IoResult{ std::move(result) };
+        }
+    }
+
+    /*
+    * IoService performs file reads, writes, fsyncs and opens asynchronously. With io_uring, requests are queued
+    * by the caller and submitted in batches by a dedicated thread that also reaps completions.
+    * If io_uring is unavailable (old kernel, seccomp, non-Linux) the requests run on a blocking thread pool.
+    * Every operation comes as a std::future and as an awaitable; coroutines are resumed on the completion
+    * thread, so they should hand heavy work off elsewhere. Buffers must outlive the operation.
+    */
+    class IoService {
+    public:
+        class Backend;
+
+        class Awaitable {
+        private:
+            struct Op : detail::IoOp {
+                std::coroutine_handle<> handle{};
+                i32 result = 0;
+            };
+
+            IoService& service_;
+            Op op_;
+
+        public:
+            Awaitable(IoService& service, detail::IoOp op) noexcept
+                : service_{ service }
+                , op_{ std::move(op) }
+            {
+                op_.complete = [](detail::IoOp* base, i32 result) noexcept {
+                    auto* op = static_cast<Op*>(base);
+                    op->result = result;
+                    op->handle.resume();
+                };
+            }
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) noexcept {
+                op_.handle = handle;
+                service_.submit_(&op_);
+            }
+
+            IoResult await_resume() noexcept {
+                return detail::to_io_result(op_.result);
+            }
+        };
+
+    private:
+        std::unique_ptr<Backend> backend_;
+
+    public:
+        explicit IoService(usize queue_depth = 256, IoBackend backend = IoBackend::eAuto) noexcept;
+
+        IoService(IoService&&) noexcept = delete;
+        IoService& operator=(IoService&&) noexcept = delete;
+
+        IoService(const IoService&) = delete;
+        IoService& operator=(const IoService&) = delete;
+
+        // Waits for all submitted operations to complete.
+        ~IoService() noexcept;
+
+        bool uses_io_uring() const noexcept;
+
+        std::future<IoResult> read(i32 fd, std::span<std::byte> buffer, u64 offset) noexcept;
+        std::future<IoResult> write(i32 fd, std::span<const std::byte> buffer, u64 offset) noexcept;
+        std::future<IoResult> fsync(i32 fd) noexcept;
+        std::future<IoResult> open(std::string_view path, i32 flags, u32 mode = 0644) noexcept;
+
+        Awaitable async_read(i32 fd, std::span<std::byte> buffer, u64 offset) noexcept {
+            return Awaitable{ *this, make_rw_(detail::IoOpcode::eRead, fd, buffer.data(), buffer.size(), offset) };
+        }
+
+        Awaitable async_write(i32 fd, std::span<const std::byte> buffer, u64 offset) noexcept {
+            return Awaitable{ *this, make_rw_(detail::IoOpcode::eWrite, fd, const_cast<std::byte*>(buffer.data()), buffer.size(), offset) };
+        }
+
+        Awaitable async_fsync(i32 fd) noexcept {
+            return Awaitable{ *this, detail::IoOp{ .opcode = detail::IoOpcode::eFsync, .fd = fd } };
+        }
+
+        Awaitable async_open(std::string_view path, i32 flags, u32 mode = 0644) noexcept {
+            return Awaitable{ *this, make_open_(path, flags, mode) };
+        }
+
+    private:
+        // Linux never transfers more than this in one call; longer requests complete short.
+        static constexpr usize max_transfer = 0x7ffff000u;
+
+        static detail::IoOp make_rw_(detail::IoOpcode opcode, i32 fd, std::byte* buffer, usize size, u64 offset) noexcept {
+            return detail::IoOp{ .opcode = opcode, .fd = fd, .buffer = buffer, .length = static_cast<u32>(std::min<usize>(size, max_transfer)), .offset = offset };
+        }
+
+        static detail::IoOp make_open_(std::string_view path, i32 flags, u32 mode) noexcept {
+            return detail::IoOp{ .opcode = detail::IoOpcode::eOpen, .path = std::string{ path }, .flags = flags, .mode = mode };
+        }
+
+        std::future<IoResult> submit_future_(detail::IoOp op) noexcept;
+        void submit_(detail::IoOp* op) noexcept;
+    };
+}
+#endif
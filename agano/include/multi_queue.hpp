@@ -0,0 +1,173 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <fuwa/types.hpp>
+
+#include "common.hpp"
+#include "wait_strategy.hpp"
+
+namespace agano {
+    /*
+    * MultiQueue is a relaxed concurrent priority queue: queues_per_thread * threads sequential binary heaps,
+    * each behind a try-lock. push() goes to a random heap; pop() locks `choices` random heaps and takes the
+    * best of their tops. pop() therefore returns one of the best few elements rather than the best one
+    * (the expected rank error grows with the number of heaps), in exchange for no single point of contention.
+    * More heaps or fewer choices mean more relaxation and more throughput. Like std::priority_queue,
+    * the "best" element is the greatest under Compare.
+    */
+    template<std::movable T, typename Compare = std::less<T>>
+    class MultiQueue {
+    private:
+        struct alignas(cache_line_size) Heap {
+            std::atomic<bool> locked{ false };
+            std::atomic<usize> size{ 0 };
+            std::vector<T> items;
+
+            bool try_lock() noexcept {
+                return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+            }
+
+            void unlock() noexcept {
+                locked.store(false, std::memory_order_release);
+            }
+        };
+
+        std::unique_ptr<Heap[]> heaps_;
+        usize heap_count_;
+        usize choices_;
+        [[no_unique_address]] Compare comp_;
+
+    public:
+        static constexpr usize default_queues_per_thread = 2u;
+        static constexpr usize default_choices = 2u;
+
+        explicit MultiQueue(usize queues_per_thread = default_queues_per_thread,
+                            usize threads = std::max(std::thread::hardware_concurrency(), 1u),
+                            usize choices = default_choices,
+                            Compare comp = {}) noexcept
+            : heap_count_{ std::max<usize>(queues_per_thread * threads, 1u) }
+            , choices_{ std::clamp<usize>(choices, 1u, std::max<usize>(queues_per_thread * threads, 1u)) }
+            , comp_{ std::move(comp) }
+        {
+            heaps_ = std::make_unique<Heap[]>(heap_count_);
+        }
+
+        MultiQueue(MultiQueue&&) noexcept = delete;
+        MultiQueue& operator=(MultiQueue&&) noexcept = delete;
+
+        MultiQueue(const MultiQueue&) = delete;
+        MultiQueue& operator=(const MultiQueue&) = delete;
+
+        ~MultiQueue() noexcept = default;
+
+        void push(T value) noexcept {
+            while (true) {
+                Heap& heap = heaps_[detail::thread_random() % heap_count_];
+                if (!heap.try_lock()) {
+                    continue;
+                }
+
+                heap.items.push_back(std::move(value));
+                std::push_heap(heap.items.begin(), heap.items.end(), comp_);
+                heap.size.store(heap.items.size(), std::memory_order_relaxed);
+                heap.unlock();
+                return;
+            }
+        }
+
+        // Returns std::nullopt only if every heap was seen empty.
+        [[nodiscard]]
+        std::optional<T> try_pop() noexcept {
+            // Random sampling misses the last few elements easily, so after this many empty samples scan all heaps.
+            const usize max_misses = heap_count_;
+
+            usize misses = 0;
+            while (misses < max_misses) {
+                Heap* best = nullptr;
+                bool contended = false;
+                for (usize i = 0; i < choices_; ++i) {
+                    Heap& heap = heaps_[detail::thread_random() % heap_count_];
+                    if (&heap == best || heap.size.load(std::memory_order_relaxed) == 0) {
+                        continue;
+                    }
+                    if (!heap.try_lock()) {
+                        contended = true;
+                        continue;
+                    }
+                    if (heap.items.empty()) {
+                        heap.unlock();
+                        continue;
+                    }
+
+                    if (best == nullptr) {
+                        best = &heap;
+                    }
+                    else if (comp_(best->items.front(), heap.items.front())) {
+                        best->unlock();
+                        best = &heap;
+                    }
+                    else {
+                        heap.unlock();
+                    }
+                }
+
+                if (best != nullptr) {
+                    return pop_locked_(*best);
+                }
+                if (!contended) {
+                    ++misses;
+                }
+            }
+
+            for (usize i = 0; i < heap_count_; ++i) {
+                Heap& heap = heaps_[i];
+                if (heap.size.load(std::memory_order_relaxed) == 0) {
+                    continue;
+                }
+
+                // Heaps are only locked for one push or pop, so spin; MultiQueue never blocks and takes no WaitStrategy.
+                while (!heap.try_lock()) {
+                    cpu_relax();
+                }
+                if (!heap.items.empty()) {
+                    return pop_locked_(heap);
+                }
+                heap.unlock();
+            }
+            return std::nullopt;
+        }
+
+        // Approximate while other threads push or pop.
+        usize size() const noexcept {
+            usize total = 0;
+            for (usize i = 0; i < heap_count_; ++i) {
+                total += heaps_[i].size.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        bool empty() const noexcept {
+            return size() == 0;
+        }
+
+        usize heap_count() const noexcept {
+            return heap_count_;
+        }
+
+    private:
+        T pop_locked_(Heap& heap) noexcept {
+            std::pop_heap(heap.items.begin(), heap.items.end(), comp_);
+            T value = std::move(heap.items.back());
+            heap.items.pop_back();
+            heap.size.store(heap.items.size(), std::memory_order_relaxed);
+            heap.unlock();
+            return value;
+        }
+    };
+}
@@ -0,0 +1,342 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include <fuwa/simd.hpp>
+#include <fuwa/types.hpp>
+
+#include "common.hpp"
+#include "thread_pool.hpp"
+
+namespace agano {
+    namespace detail {
+        inline constexpr usize cache_block_bytes = 256u * 1024u;
+        inline constexpr usize sort_oversampling = 16u;
+        inline constexpr usize max_sort_buckets = 1024u;
+
+        // Number of elements processed by a single task: roughly one L2-sized block.
+        template<typename T>
+        constexpr usize block_size() noexcept {
+            return std::max<usize>(cache_block_bytes / sizeof(T), 1024u);
+        }
+
+        constexpr usize block_count(usize n, usize block) noexcept {
+            return (n + block - 1) / block;
+        }
+
+        // Uninitialized scratch storage for n objects of type T.
+        template<typename T>
+        class Scratch {
+        private:
+            std::allocator<T> alloc_;
+            T* data_;
+            usize size_;
+
+        public:
+            explicit Scratch(usize size) noexcept
+                : data_{ alloc_.allocate(size) }
+                , size_{ size }
+            {}
+
+            Scratch(Scratch&&) noexcept = delete;
+            Scratch& operator=(Scratch&&) noexcept = delete;
+
+            Scratch(const Scratch&) = delete;
+            Scratch& operator=(const Scratch&) = delete;
+
+            ~Scratch() noexcept {
+                alloc_.deallocate(data_, size_);
+            }
+
+            T* data() noexcept {
+                return data_;
+            }
+        };
+    }
+
+    /*
+    * Parallel samplesort. Splitters are taken from an oversampled random sample, every cache-sized
+    * block of the input is classified into buckets in parallel, elements are scattered into a scratch
+    * buffer and buckets are sorted independently. Not stable. Small inputs are sorted serially.
+    */
+    template<std::random_access_iterator It, typename Compare = std::less<>>
+    void parallel_sort(ThreadPool& pool, It first, It last, Compare comp = {}) noexcept {
+        using T = std::iter_value_t<It>;
+
+        const usize n = static_cast<usize>(last - first);
+        const usize block = detail::block_size<T>();
+        if (n <= 2 * block || pool.thread_count() == 0) {
+            std::sort(first, last, comp);
+            return;
+        }
+
+        const usize bucket_count = std::clamp<usize>(4 * (pool.thread_count() + 1), 2, std::min(detail::max_sort_buckets, n / block + 1));
+
+        std::vector<T> samples;
+        samples.reserve(bucket_count * detail::sort_oversampling);
+        u64 seed = n;
+        for (usize i = 0; i < bucket_count * detail::sort_oversampling; ++i) {
+            samples.push_back(first[static_cast<std::iter_difference_t<It>>(detail::splitmix64(seed) % n)]);
+        }
+        std::sort(samples.begin(), samples.end(), comp);
+
+        std::vector<T> splitters;
+        splitters.reserve(bucket_count - 1);
+        for (usize i = 1; i < bucket_count; ++i) {
+            splitters.push_back(samples[i * detail::sort_oversampling]);
+        }
+
+        const usize blocks = detail::block_count(n, block);
+        std::vector<u16> bucket_of(n);
+        std::vector<usize> counts(blocks * bucket_count, 0);
+
+        parallel_for(pool, blocks, [&](usize b) {
+            const usize begin = b * block;
+            const usize end = std::min(begin + block, n);
+            usize* block_counts = counts.data() + b * bucket_count;
+
+            for (usize i = begin; i < end; ++i) {
+                const auto bucket = static_cast<u16>(std::upper_bound(splitters.begin(), splitters.end(), first[static_cast<std::iter_difference_t<It>>(i)], comp) - splitters.begin());
+                bucket_of[i] = bucket;
+                ++block_counts[bucket];
+            }
+        });
+
+        // Turn per-block counts into scatter offsets, bucket-major so every bucket is contiguous.
+        std::vector<usize> bucket_begin(bucket_count + 1, 0);
+        usize offset = 0;
+        for (usize k = 0; k < bucket_count; ++k) {
+            bucket_begin[k] = offset;
+            for (usize b = 0; b < blocks; ++b) {
+                const usize count = counts[b * bucket_count + k];
+                counts[b * bucket_count + k] = offset;
+                offset += count;
+            }
+        }
+        bucket_begin[bucket_count] = n;
+
+        detail::Scratch<T> scratch{ n };
+        T* buffer = scratch.data();
+
+        parallel_for(pool, blocks, [&](usize b) {
+            const usize begin = b * block;
+            const usize end = std::min(begin + block, n);
+            usize* block_offsets = counts.data() + b * bucket_count;
+
+            for (usize i = begin; i < end; ++i) {
+                std::construct_at(buffer + block_offsets[bucket_of[i]]++, std::move(first[static_cast<std::iter_difference_t<It>>(i)]));
+            }
+        });
+
+        parallel_for(pool, bucket_count, [&](usize k) {
+            const usize begin = bucket_begin[k];
+            const usize end = bucket_begin[k + 1];
+
+            std::sort(buffer + begin, buffer + end, comp);
+            for (usize i = begin; i < end; ++i) {
+                first[static_cast<std::iter_difference_t<It>>(i)] = std::move(buffer[i]);
+            }
+            std::destroy(buffer + begin, buffer + end);
+        });
+    }
+
+    template<std::random_access_iterator It, typename Compare = std::less<>>
+    void parallel_sort(It first, It last, Compare comp = {}) noexcept {
+        parallel_sort(global_pool(), first, last, comp);
+    }
+
+    namespace detail {
+        // Three-pass blocked scan: reduce every block, scan block totals serially, rescan blocks with carries.
+        template<typename It, typename OutIt, typename T, typename BinaryOp, bool Inclusive>
+        OutIt blocked_scan(ThreadPool& pool, It first, It last, OutIt d_first, T init, bool has_init, BinaryOp op) noexcept {
+            const usize n = static_cast<usize>(last - first);
+            const usize block = block_size<T>();
+            const usize blocks = block_count(n, block);
+
+            auto scan_block = [&](usize begin, usize end, T carry, bool has_carry) {
+                It in = first + static_cast<std::iter_difference_t<It>>(begin);
+                OutIt out = d_first + static_cast<std::iter_difference_t<OutIt>>(begin);
+
+                if constexpr (Inclusive) {
+                    // Peel the element that starts the sum, so the loop below has no branch and vectorizes.
+                    if (!has_carry && begin < end) {
+                        carry = T(*in);
+                        *out = carry;
+                        ++in;
+                        ++out;
+                        ++begin;
+                    }
+
+                    for (usize i = begin; i < end; ++i, ++in, ++out) {
+                        carry = op(carry, *in);
+                        *out = carry;
+                    }
+                }
+                else {
+                    for (usize i = begin; i < end; ++i, ++in, ++out) {
+                        T value = *in;
+                        *out = carry;
+                        carry = op(carry, value);
+                    }
+                }
+            };
+
+            if (n <= 2 * block || pool.thread_count() == 0) {
+                scan_block(0, n, init, has_init);
+                return d_first + static_cast<std::iter_difference_t<OutIt>>(n);
+            }
+
+            std::vector<T> totals(blocks, init);
+            parallel_for(pool, blocks - 1, [&](usize b) {
+                It in = first + static_cast<std::iter_difference_t<It>>(b * block);
+                It end = first + static_cast<std::iter_difference_t<It>>(std::min(b * block + block, n));
+
+                T sum = *in;
+                for (++in; in != end; ++in) {
+                    sum = op(sum, *in);
+                }
+                totals[b] = sum;
+            });
+
+            // totals[b] becomes the carry into block b.
+            T carry = init;
+            bool has_carry = has_init;
+            for (usize b = 0; b < blocks; ++b) {
+                T block_total = totals[b];
+                totals[b] = carry;
+                if (b + 1 < blocks) {
+                    carry = has_carry ? op(carry, block_total) : block_total;
+                    has_carry = true;
+                }
+            }
+
+            parallel_for(pool, blocks, [&](usize b) {
+                scan_block(b * block, std::min(b * block + block, n), totals[b], b != 0 || has_init);
+            });
+
+            return d_first + static_cast<std::iter_difference_t<OutIt>>(n);
+        }
+    }
+
+    /*
+    * Parallel prefix sums. Both functions accept d_first == first. op must be associative.
+    */
+    template<std::random_access_iterator It, std::random_access_iterator OutIt, typename BinaryOp = std::plus<>>
+    OutIt parallel_inclusive_scan(ThreadPool& pool, It first, It last, OutIt d_first, BinaryOp op = {}) noexcept {
+        using T = std::iter_value_t<It>;
+        if (first == last) {
+            return d_first;
+        }
+
+        return detail::blocked_scan<It, OutIt, T, BinaryOp, true>(pool, first, last, d_first, T(*first), false, op);
+    }
+
+    template<std::random_access_iterator It, std::random_access_iterator OutIt, typename BinaryOp = std::plus<>>
+    OutIt parallel_inclusive_scan(It first, It last, OutIt d_first, BinaryOp op = {}) noexcept {
+        return parallel_inclusive_scan(global_pool(), first, last, d_first, op);
+    }
+
+    template<std::random_access_iterator It, std::random_access_iterator OutIt, typename T, typename BinaryOp = std::plus<>>
+    OutIt parallel_exclusive_scan(ThreadPool& pool, It first, It last, OutIt d_first, T init, BinaryOp op = {}) noexcept {
+        return detail::blocked_scan<It, OutIt, T, BinaryOp, false>(pool, first, last, d_first, std::move(init), true, op);
+    }
+
+    template<std::random_access_iterator It, std::random_access_iterator OutIt, typename T, typename BinaryOp = std::plus<>>
+    OutIt parallel_exclusive_scan(It first, It last, OutIt d_first, T init, BinaryOp op = {}) noexcept {
+        return parallel_exclusive_scan(global_pool(), first, last, d_first, std::move(init), op);
+    }
+
+    /*
+    * Parallel stable partition. pred is evaluated exactly once per element; elements are moved
+    * through a scratch buffer. Returns the first element of the second group.
+    */
+    template<std::random_access_iterator It, typename Pred>
+    It parallel_stable_partition(ThreadPool& pool, It first, It last, Pred pred) noexcept {
+        using T = std::iter_value_t<It>;
+        using Diff = std::iter_difference_t<It>;
+
+        const usize n = static_cast<usize>(last - first);
+        const usize block = detail::block_size<T>();
+        if (n <= 2 * block || pool.thread_count() == 0) {
+            return std::stable_partition(first, last, pred);
+        }
+
+        const usize blocks = detail::block_count(n, block);
+        std::vector<u8> flags(n);
+        std::vector<usize> selected(blocks, 0);
+
+        parallel_for(pool, blocks, [&](usize b) {
+            const usize begin = b * block;
+            const usize end = std::min(begin + block, n);
+
+            usize count = 0;
+            for (usize i = begin; i < end; ++i) {
+                const u8 flag = pred(first[static_cast<Diff>(i)]) ? 1u : 0u;
+                flags[i] = flag;
+                count += flag;
+            }
+            selected[b] = count;
+        });
+
+        usize total_selected = 0;
+        for (usize b = 0; b < blocks; ++b) {
+            const usize count = selected[b];
+            selected[b] = total_selected;
+            total_selected += count;
+        }
+
+        detail::Scratch<T> scratch{ n };
+        T* buffer = scratch.data();
+
+        parallel_for(pool, blocks, [&](usize b) {
+            const usize begin = b * block;
+            const usize end = std::min(begin + block, n);
+
+            using Flags = eh::simd::u8x32;
+            const Flags ones = Flags::splat(1u);
+
+            usize yes = selected[b];
+            usize no = total_selected + (begin - selected[b]);
+            usize i = begin;
+            // Runs of flags that all go the same way are moved as a block instead of element by element.
+            for (; i + Flags::lanes <= end; i += Flags::lanes) {
+                const u32 mask = eh::simd::movemask(eh::simd::cmp_eq(Flags::load(flags.data() + i), ones));
+                if (mask == Flags::full_mask || mask == 0u) {
+                    usize& out = mask != 0u ? yes : no;
+                    for (usize k = 0; k < Flags::lanes; ++k) {
+                        std::construct_at(buffer + out + k, std::move(first[static_cast<Diff>(i + k)]));
+                    }
+                    out += Flags::lanes;
+                    continue;
+                }
+
+                for (usize k = 0; k < Flags::lanes; ++k) {
+                    std::construct_at(buffer + (((mask >> k) & 1u) != 0u ? yes++ : no++), std::move(first[static_cast<Diff>(i + k)]));
+                }
+            }
+            for (; i < end; ++i) {
+                std::construct_at(buffer + (flags[i] ? yes++ : no++), std::move(first[static_cast<Diff>(i)]));
+            }
+        });
+
+        parallel_for(pool, blocks, [&](usize b) {
+            const usize begin = b * block;
+            const usize end = std::min(begin + block, n);
+
+            for (usize i = begin; i < end; ++i) {
+                first[static_cast<Diff>(i)] = std::move(buffer[i]);
+            }
+            std::destroy(buffer + begin, buffer + end);
+        });
+
+        return first + static_cast<Diff>(total_selected);
+    }
+
+    template<std::random_access_iterator It, typename Pred>
+    It parallel_stable_partition(It first, It last, Pred pred) noexcept {
+        return parallel_stable_partition(global_pool(), first, last, pred);
+    }
+}
@@ -0,0 +1,443 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <fuwa/types.hpp>
+
+#include "agano.hpp"
+
+namespace agano {
+    template<std::copy_constructible K, std::copy_constructible V, typename Hash, typename Eq>
+    class TransientMap;
+
+    namespace detail {
+        /*
+        * HAMT node in the CHAMP layout: datamap marks slots that hold an entry inline, nodemap marks slots that
+        * hold a subtree; both arrays are kept in slot order. Once the 64 hash bits are used up a node becomes a
+        * collision node that just stores its entries in a list.
+        */
+        template<typename K, typename V>
+        struct HamtNode {
+            struct Entry {
+                u64 hash;
+                K key;
+                V value;
+            };
+
+            class Ref {
+            private:
+                HamtNode* node_ = nullptr;
+
+            public:
+                Ref() noexcept = default;
+
+                explicit Ref(HamtNode* node) noexcept
+                    : node_{ node }
+                {}
+
+                Ref(const Ref& rhs) noexcept
+                    : node_{ rhs.node_ }
+                {
+                    if (node_ != nullptr) {
+                        node_->refs.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+
+                Ref& operator=(const Ref& rhs) noexcept {
+                    Ref{ rhs }.swap(*this);
+                    return *this;
+                }
+
+                Ref(Ref&& rhs) noexcept
+                    : node_{ std::exchange(rhs.node_, nullptr) }
+                {}
+
+                Ref& operator=(Ref&& rhs) noexcept {
+                    Ref{ std::move(rhs) }.swap(*this);
+                    return *this;
+                }
+
+                ~Ref() noexcept {
+                    if (node_ != nullptr && node_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        delete node_;
+                    }
+                }
+
+                HamtNode* get() const noexcept {
+                    return node_;
+                }
+
+                HamtNode* operator->() const noexcept {
+                    return node_;
+                }
+
+                // No other handle can reach the node, so it may be changed in place.
+                bool unique() const noexcept {
+                    return node_ != nullptr && node_->refs.load(std::memory_order_acquire) == 1;
+                }
+
+                void swap(Ref& rhs) noexcept {
+                    std::swap(node_, rhs.node_);
+                }
+            };
+
+            static constexpr u32 bits = 5u;
+            static constexpr u32 mask = (1u << bits) - 1u;
+
+            std::atomic<u32> refs{ 1 };
+            u32 datamap = 0;
+            u32 nodemap = 0;
+            bool collision = false;
+            std::vector<Entry> entries;
+            std::vector<Ref> children;
+
+            HamtNode() noexcept = default;
+
+            HamtNode(const HamtNode& rhs) noexcept
+                : datamap{ rhs.datamap }
+                , nodemap{ rhs.nodemap }
+                , collision{ rhs.collision }
+                , entries{ rhs.entries }
+                , children{ rhs.children }
+            {}
+
+            HamtNode& operator=(const HamtNode&) = delete;
+
+            static u32 slot_bit(u64 hash, u32 shift) noexcept {
+                return 1u << static_cast<u32>((hash >> shift) & mask);
+            }
+
+            static u32 index(u32 map, u32 bit) noexcept {
+                return static_cast<u32>(std::popcount(map & (bit - 1u)));
+            }
+
+            // Makes the node behind `ref` safe to change, copying it (one level deep) if it is shared.
+            static HamtNode* editable(Ref& ref) noexcept {
+                if (!ref.unique()) {
+                    ref = Ref{ new HamtNode{ *ref.get() } };
+                }
+                return ref.get();
+            }
+
+            static Ref merge(Entry&& lhs, Entry&& rhs, u32 shift) noexcept {
+                Ref ref{ new HamtNode{} };
+                HamtNode* node = ref.get();
+
+                if (shift >= 64u) {
+                    node->collision = true;
+                    node->entries.push_back(std::move(lhs));
+                    node->entries.push_back(std::move(rhs));
+                    return ref;
+                }
+
+                const u32 lhs_bit = slot_bit(lhs.hash, shift);
+                const u32 rhs_bit = slot_bit(rhs.hash, shift);
+                if (lhs_bit == rhs_bit) {
+                    node->nodemap = lhs_bit;
+                    node->children.push_back(merge(std::move(lhs), std::move(rhs), shift + bits));
+                    return ref;
+                }
+
+                node->datamap = lhs_bit | rhs_bit;
+                if (lhs_bit < rhs_bit) {
+                    node->entries.push_back(std::move(lhs));
+                    node->entries.push_back(std::move(rhs));
+                }
+                else {
+                    node->entries.push_back(std::move(rhs));
+                    node->entries.push_back(std::move(lhs));
+                }
+                return ref;
+            }
+
+            template<typename Eq>
+            static const V* find(const HamtNode* node, u64 hash, const K& key, const Eq& eq) noexcept {
+                u32 shift = 0;
+                while (node != nullptr) {
+                    if (node->collision) {
+                        for (const auto& entry : node->entries) {
+                            if (eq(entry.key, key)) {
+                                return &entry.value;
+                            }
+                        }
+                        return nullptr;
+                    }
+
+                    const u32 bit = slot_bit(hash, shift);
+                    if ((node->datamap & bit) != 0) {
+                        const Entry& entry = node->entries[index(node->datamap, bit)];
+                        return entry.hash == hash && eq(entry.key, key) ? &entry.value : nullptr;
+                    }
+                    if ((node->nodemap & bit) == 0) {
+                        return nullptr;
+                    }
+
+                    node = node->children[index(node->nodemap, bit)].get();
+                    shift += bits;
+                }
+                return nullptr;
+            }
+
+            // Returns true if a new key was added, false if an existing value was replaced.
+            template<typename Eq>
+            static bool insert(Ref& ref, u32 shift, Entry&& entry, const Eq& eq) noexcept {
+                HamtNode* node = editable(ref);
+
+                if (node->collision) {
+                    for (auto& existing : node->entries) {
+                        if (eq(existing.key, entry.key)) {
+                            existing.value = std::move(entry.value);
+                            return false;
+                        }
+                    }
+                    node->entries.push_back(std::move(entry));
+                    return true;
+                }
+
+                const u32 bit = slot_bit(entry.hash, shift);
+                if ((node->datamap & bit) != 0) {
+                    const u32 at = index(node->datamap, bit);
+                    Entry& existing = node->entries[at];
+                    if (existing.hash == entry.hash && eq(existing.key, entry.key)) {
+                        existing.value = std::move(entry.value);
+                        return false;
+                    }
+
+                    // Two keys share this slot: push both one level down.
+                    Ref child = merge(std::move(existing), std::move(entry), shift + bits);
+                    node->entries.erase(node->entries.begin() + at);
+                    node->datamap ^= bit;
+                    node->nodemap |= bit;
+                    node->children.insert(node->children.begin() + index(node->nodemap, bit), std::move(child));
+                    return true;
+                }
+
+                if ((node->nodemap & bit) != 0) {
+                    return insert(node->children[index(node->nodemap, bit)], shift + bits, std::move(entry), eq);
+                }
+
+                node->datamap |= bit;
+                node->entries.insert(node->entries.begin() + index(node->datamap, bit), std::move(entry));
+                return true;
+            }
+
+            // The key must be present. Subtrees left with a single entry are folded into their parent.
+            template<typename Eq>
+            static void erase(Ref& ref, u32 shift, u64 hash, const K& key, const Eq& eq) noexcept {
+                HamtNode* node = editable(ref);
+
+                if (node->collision) {
+                    for (usize i = 0; i < node->entries.size(); ++i) {
+                        if (eq(node->entries[i].key, key)) {
+                            node->entries.erase(node->entries.begin() + static_cast<isize>(i));
+                            return;
+                        }
+                    }
+                    return;
+                }
+
+                const u32 bit = slot_bit(hash, shift);
+                if ((node->datamap & bit) != 0) {
+                    node->entries.erase(node->entries.begin() + index(node->datamap, bit));
+                    node->datamap ^= bit;
+                    return;
+                }
+
+                const u32 at = index(node->nodemap, bit);
+                erase(node->children[at], shift + bits, hash, key, eq);
+
+                HamtNode* child = node->children[at].get();
+                if (child->nodemap == 0 && child->entries.size() == 1) {
+                    // The recursive call made the child unique, so its entry can be moved out.
+                    Entry entry = std::move(child->entries.front());
+                    node->children.erase(node->children.begin() + at);
+                    node->nodemap ^= bit;
+                    node->datamap |= bit;
+                    node->entries.insert(node->entries.begin() + index(node->datamap, bit), std::move(entry));
+                }
+            }
+
+            template<typename Fn>
+            static void for_each(const HamtNode* node, Fn& fn) noexcept {
+                if (node == nullptr) {
+                    return;
+                }
+
+                for (const auto& entry : node->entries) {
+                    fn(std::as_const(entry.key), std::as_const(entry.value));
+                }
+                for (const auto& child : node->children) {
+                    for_each(child.get(), fn);
+                }
+            }
+        };
+    }
+
+    /*
+    * PersistentMap is an immutable hash map (a hash array mapped trie). insert() and erase() return a new map
+    * that shares every node off the changed path with the old one, so an update copies O(log32 n) nodes and
+    * copying a map is a single reference count bump. Maps can be read from many threads at once; publish them
+    * through AtomicArc or Synced<Cow<...>>. For bulk loads use transient(), which edits unshared nodes in place.
+    */
+    template<std::copy_constructible K, std::copy_constructible V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+    class PersistentMap {
+    private:
+        using Node = detail::HamtNode<K, V>;
+        using Entry = typename Node::Entry;
+
+        typename Node::Ref root_;
+        usize size_ = 0;
+        [[no_unique_address]] Hash hash_;
+        [[no_unique_address]] Eq eq_;
+
+        friend class TransientMap<K, V, Hash, Eq>;
+
+        PersistentMap(typename Node::Ref root, usize size) noexcept
+            : root_{ std::move(root) }
+            , size_{ size }
+        {}
+
+    public:
+        PersistentMap() noexcept = default;
+
+        [[nodiscard]]
+        PersistentMap insert(K key, V value) const& noexcept {
+            PersistentMap result{ *this };
+            result.insert_(std::move(key), std::move(value));
+            return result;
+        }
+
+        // Reuses the nodes this map does not share with any other map.
+        [[nodiscard]]
+        PersistentMap insert(K key, V value) && noexcept {
+            return std::move(insert_(std::move(key), std::move(value)));
+        }
+
+        [[nodiscard]]
+        PersistentMap erase(const K& key) const& noexcept {
+            if (!contains(key)) {
+                return *this;
+            }
+            PersistentMap result{ *this };
+            result.erase_(key);
+            return result;
+        }
+
+        [[nodiscard]]
+        PersistentMap erase(const K& key) && noexcept {
+            if (!contains(key)) {
+                return std::move(*this);
+            }
+            return std::move(erase_(key));
+        }
+
+        const V* find(const K& key) const noexcept {
+            return Node::find(root_.get(), static_cast<u64>(hash_(key)), key, eq_);
+        }
+
+        bool contains(const K& key) const noexcept {
+            return find(key) != nullptr;
+        }
+
+        usize size() const noexcept {
+            return size_;
+        }
+
+        bool empty() const noexcept {
+            return size_ == 0;
+        }
+
+        // Calls fn(const K&, const V&) for every entry, in no particular order.
+        template<typename Fn>
+            requires std::invocable<Fn&, const K&, const V&>
+        void for_each(Fn&& fn) const noexcept {
+            Node::for_each(root_.get(), fn);
+        }
+
+        [[nodiscard]]
+        TransientMap<K, V, Hash, Eq> transient() const noexcept;
+
+    private:
+        PersistentMap& insert_(K&& key, V&& value) noexcept {
+            if (root_.get() == nullptr) {
+                root_ = typename Node::Ref{ new Node{} };
+            }
+
+            const auto hash = static_cast<u64>(hash_(key));
+            if (Node::insert(root_, 0, Entry{ hash, std::move(key), std::move(value) }, eq_)) {
+                ++size_;
+            }
+            return *this;
+        }
+
+        PersistentMap& erase_(const K& key) noexcept {
+            Node::erase(root_, 0, static_cast<u64>(hash_(key)), key, eq_);
+            --size_;
+            return *this;
+        }
+    };
+
+    /*
+    * Mutable builder over a PersistentMap. Nodes it has already copied belong to it alone and are edited in
+    * place, so loading many entries costs little more than a regular hash map. Not thread-safe.
+    */
+    template<std::copy_constructible K, std::copy_constructible V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+    class TransientMap {
+    private:
+        PersistentMap<K, V, Hash, Eq> map_;
+
+    public:
+        TransientMap() noexcept = default;
+
+        explicit TransientMap(PersistentMap<K, V, Hash, Eq> map) noexcept
+            : map_{ std::move(map) }
+        {}
+
+        TransientMap(TransientMap&&) noexcept = default;
+        TransientMap& operator=(TransientMap&&) noexcept = default;
+
+        TransientMap(const TransientMap&) = delete;
+        TransientMap& operator=(const TransientMap&) = delete;
+
+        ~TransientMap() noexcept = default;
+
+        void insert(K key, V value) noexcept {
+            map_.insert_(std::move(key), std::move(value));
+        }
+
+        void erase(const K& key) noexcept {
+            if (map_.contains(key)) {
+                map_.erase_(key);
+            }
+        }
+
+        const V* find(const K& key) const noexcept {
+            return map_.find(key);
+        }
+
+        usize size() const noexcept {
+            return map_.size();
+        }
+
+        [[nodiscard]]
+        PersistentMap<K, V, Hash, Eq> persistent() && noexcept {
+            return std::move(map_);
+        }
+    };
+
+    template<std::copy_constructible K, std::copy_constructible V, typename Hash, typename Eq>
+    TransientMap<K, V, Hash, Eq> PersistentMap<K, V, Hash, Eq>::transient() const noexcept {
+        return TransientMap<K, V, Hash, Eq>{ *this };
+    }
+
+    // Maps share nodes across threads, so entries are read by several threads and freed by whichever drops them last.
+    template<typename K, typename V, typename Hash, typename Eq> requires Send<K> && Sync<K> && Send<V> && Sync<V>
+    inline constexpr bool send_tag_v<PersistentMap<K, V, Hash, Eq>> = true;
+
+    template<typename K, typename V, typename Hash, typename Eq> requires Send<K> && Sync<K> && Send<V> && Sync<V>
+    inline constexpr bool send_tag_v<const PersistentMap<K, V, Hash, Eq>&> = true;
+}
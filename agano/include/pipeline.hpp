@@ -0,0 +1,397 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "agano.hpp"
+#include "channel.hpp"
+
+namespace agano {
+    enum class StageOrder {
+        eUnordered = 0,
+        eInOrder,
+    };
+
+    struct StageStats {
+        std::string name;
+        u64 processed;
+        f64 items_per_second;
+        usize queue_size;
+        usize queue_capacity;
+    };
+
+    namespace detail {
+        template<typename T>
+        struct Sequenced {
+            u64 seq;
+            T value;
+        };
+
+        /*
+        * Restores input order: emit(seq, value) is called strictly by ascending sequence number.
+        * emit runs outside of the lock, since for a middle stage it is a push that may block on backpressure.
+        * One submitter at a time is the emitter; it keeps draining whatever became ready while it was emitting,
+        * and the others just park their items and return to work.
+        */
+        template<typename T>
+        class Reorder {
+        private:
+            std::mutex mutex_;
+            std::map<u64, T> pending_;
+            u64 next_ = 0;
+            bool emitting_ = false;
+
+        public:
+            template<typename Emit>
+            void submit(u64 seq, T&& value, Emit&& emit) noexcept {
+                std::vector<std::pair<u64, T>> ready;
+                {
+                    std::lock_guard lock{ mutex_ };
+                    if (emitting_ || seq != next_) {
+                        pending_.emplace(seq, std::move(value));
+                        return;
+                    }
+
+                    emitting_ = true;
+                    ready.emplace_back(next_++, std::move(value));
+                    take_ready_(ready);
+                }
+
+                while (true) {
+                    for (auto& [ready_seq, ready_value] : ready) {
+                        emit(ready_seq, std::move(ready_value));
+                    }
+                    ready.clear();
+
+                    std::lock_guard lock{ mutex_ };
+                    take_ready_(ready);
+                    if (ready.empty()) {
+                        emitting_ = false;
+                        return;
+                    }
+                }
+            }
+
+        private:
+            void take_ready_(std::vector<std::pair<u64, T>>& ready) noexcept {
+                for (auto it = pending_.begin(); it != pending_.end() && it->first == next_; it = pending_.erase(it)) {
+                    ready.emplace_back(next_++, std::move(it->second));
+                }
+            }
+        };
+
+        struct PipelineShared {
+            std::counting_semaphore<> in_flight;
+            std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+            explicit PipelineShared(usize max_in_flight) noexcept
+                : in_flight{ static_cast<std::ptrdiff_t>(max_in_flight) }
+            {}
+        };
+
+        template<typename Out>
+        struct StageOutput {
+            using type = std::shared_ptr<Channel<Sequenced<Out>>>;
+        };
+
+        template<>
+        struct StageOutput<void> {
+            using type = std::monostate;
+        };
+
+        class StageBase {
+        public:
+            virtual ~StageBase() noexcept = default;
+
+            virtual void start() noexcept = 0;
+            virtual void join() noexcept = 0;
+            virtual StageStats stats() const noexcept = 0;
+        };
+
+        /*
+        * A stage runs `parallelism` dedicated threads popping from its input channel. Each thread keeps
+        * its own State in a ThreadBound. The last thread to finish closes the output channel. A stage
+        * with Out = void is the sink: it returns in-flight tokens to the pipeline.
+        */
+        template<typename In, typename Out, typename State, typename Init, typename Fn>
+        class Stage final : public StageBase {
+        private:
+            using OutChannel = typename StageOutput<Out>::type;
+            using Reordered = std::conditional_t<std::is_void_v<Out>, In, Out>;
+
+            std::string name_;
+            usize parallelism_;
+            StageOrder order_;
+            Init init_;
+            Fn fn_;
+            std::shared_ptr<Channel<Sequenced<In>>> input_;
+            OutChannel output_;
+            std::shared_ptr<PipelineShared> shared_;
+
+            Reorder<Reordered> reorder_;
+            std::vector<std::thread> threads_;
+            std::atomic<usize> running_{ 0 };
+            std::atomic<u64> processed_{ 0 };
+
+        public:
+            Stage(std::string name, usize parallelism, StageOrder order, Init init, Fn fn,
+                  std::shared_ptr<Channel<Sequenced<In>>> input, OutChannel output, std::shared_ptr<PipelineShared> shared) noexcept
+                : name_{ std::move(name) }
+                , parallelism_{ std::max<usize>(parallelism, 1u) }
+                , order_{ order }
+                , init_{ std::move(init) }
+                , fn_{ std::move(fn) }
+                , input_{ std::move(input) }
+                , output_{ std::move(output) }
+                , shared_{ std::move(shared) }
+            {}
+
+            void start() noexcept override {
+                running_.store(parallelism_, std::memory_order_relaxed);
+                for (usize i = 0; i < parallelism_; ++i) {
+                    threads_.emplace_back([this] { worker_(); });
+                }
+            }
+
+            void join() noexcept override {
+                for (auto& thread : threads_) {
+                    thread.join();
+                }
+                threads_.clear();
+            }
+
+            StageStats stats() const noexcept override {
+                const u64 processed = processed_.load(std::memory_order_relaxed);
+                const f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - shared_->started).count();
+
+                return StageStats{
+                    .name = name_,
+                    .processed = processed,
+                    .items_per_second = seconds > 0.0 ? static_cast<f64>(processed) / seconds : 0.0,
+                    .queue_size = input_->size(),
+                    .queue_capacity = input_->capacity(),
+                };
+            }
+
+        private:
+            void worker_() noexcept {
+                ThreadBound<State> state{ init_() };
+
+                while (auto item = input_->pop()) {
+                    if constexpr (std::is_void_v<Out>) {
+                        auto consume = [this, &state](u64, In&& value) {
+                            fn_(*state, std::move(value));
+                            shared_->in_flight.release();
+                        };
+
+                        if (order_ == StageOrder::eInOrder) {
+                            reorder_.submit(item->seq, std::move(item->value), consume);
+                        }
+                        else {
+                            consume(item->seq, std::move(item->value));
+                        }
+                    }
+                    else {
+                        auto emit = [this](u64 seq, Out&& value) {
+                            output_->push(Sequenced<Out>{ seq, std::move(value) });
+                        };
+                        Out result = fn_(*state, std::move(item->value));
+
+                        if (order_ == StageOrder::eInOrder) {
+                            reorder_.submit(item->seq, std::move(result), emit);
+                        }
+                        else {
+                            emit(item->seq, std::move(result));
+                        }
+                    }
+
+                    processed_.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                if (running_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if constexpr (!std::is_void_v<Out>) {
+                        output_->close();
+                    }
+                }
+            }
+        };
+
+        template<typename Fn>
+        struct Stateless {
+            Fn fn;
+
+            template<typename In>
+            decltype(auto) operator()(std::monostate&, In&& value) noexcept {
+                return fn(std::forward<In>(value));
+            }
+        };
+
+        inline constexpr auto no_state = [] { return std::monostate{}; };
+    }
+
+    /*
+    * A running pipeline. push() blocks while the pipeline already holds max_in_flight items
+    * or the first stage's channel is full. close() ends the input, wait() joins all stages.
+    */
+    template<typename In>
+    class Pipeline {
+    private:
+        std::vector<std::unique_ptr<detail::StageBase>> stages_;
+        std::shared_ptr<Channel<detail::Sequenced<In>>> input_;
+        std::shared_ptr<detail::PipelineShared> shared_;
+        // Taking a sequence number and enqueueing it is one step, so a push that fails after close() leaves no gap.
+        std::mutex push_mutex_;
+        u64 next_seq_ = 0;
+        bool joined_ = false;
+
+    public:
+        Pipeline(std::vector<std::unique_ptr<detail::StageBase>> stages, std::shared_ptr<Channel<detail::Sequenced<In>>> input, std::shared_ptr<detail::PipelineShared> shared) noexcept
+            : stages_{ std::move(stages) }
+            , input_{ std::move(input) }
+            , shared_{ std::move(shared) }
+        {
+            for (auto& stage : stages_) {
+                stage->start();
+            }
+        }
+
+        Pipeline(Pipeline&&) noexcept = delete;
+        Pipeline& operator=(Pipeline&&) noexcept = delete;
+
+        Pipeline(const Pipeline&) = delete;
+        Pipeline& operator=(const Pipeline&) = delete;
+
+        ~Pipeline() noexcept {
+            close();
+            wait();
+        }
+
+        // Returns false if the pipeline has been closed.
+        bool push(In&& value) noexcept {
+            if (input_->is_closed()) {
+                return false;
+            }
+
+            shared_->in_flight.acquire();
+            {
+                std::lock_guard lock{ push_mutex_ };
+                if (input_->push(detail::Sequenced<In>{ next_seq_, std::move(value) })) {
+                    ++next_seq_;
+                    return true;
+                }
+            }
+            shared_->in_flight.release();
+            return false;
+        }
+
+        void close() noexcept {
+            input_->close();
+        }
+
+        void wait() noexcept {
+            if (joined_) {
+                return;
+            }
+
+            for (auto& stage : stages_) {
+                stage->join();
+            }
+            joined_ = true;
+        }
+
+        std::vector<StageStats> stats() const noexcept {
+            std::vector<StageStats> result;
+            result.reserve(stages_.size());
+            for (const auto& stage : stages_) {
+                result.push_back(stage->stats());
+            }
+            return result;
+        }
+    };
+
+    template<typename In, typename Cur>
+    class PipelineBuilder {
+    private:
+        usize capacity_;
+        std::vector<std::unique_ptr<detail::StageBase>> stages_;
+        std::shared_ptr<Channel<detail::Sequenced<In>>> input_;
+        std::shared_ptr<Channel<detail::Sequenced<Cur>>> tail_;
+        std::shared_ptr<detail::PipelineShared> shared_;
+
+        template<typename, typename>
+        friend class PipelineBuilder;
+
+        template<typename T>
+        friend PipelineBuilder<T, T> make_pipeline(usize, usize) noexcept;
+
+        PipelineBuilder(usize capacity, std::vector<std::unique_ptr<detail::StageBase>> stages, std::shared_ptr<Channel<detail::Sequenced<In>>> input,
+                        std::shared_ptr<Channel<detail::Sequenced<Cur>>> tail, std::shared_ptr<detail::PipelineShared> shared) noexcept
+            : capacity_{ capacity }
+            , stages_{ std::move(stages) }
+            , input_{ std::move(input) }
+            , tail_{ std::move(tail) }
+            , shared_{ std::move(shared) }
+        {}
+
+    public:
+        // Adds a stage whose threads each own a State created by init(); fn(State&, Cur) produces the next item.
+        template<typename Init, typename Fn>
+            requires std::invocable<Init&> && std::invocable<Fn&, std::invoke_result_t<Init&>&, Cur&&>
+        auto stage(std::string name, usize parallelism, StageOrder order, Init init, Fn fn) && noexcept {
+            using State = std::invoke_result_t<Init&>;
+            using Out = std::invoke_result_t<Fn&, State&, Cur&&>;
+            static_assert(!std::is_void_v<Out>, "A stage must produce a value, use sink() for the last stage");
+
+            auto output = std::make_shared<Channel<detail::Sequenced<Out>>>(capacity_);
+            stages_.push_back(std::make_unique<detail::Stage<Cur, Out, State, Init, Fn>>(std::move(name), parallelism, order, std::move(init), std::move(fn), tail_, output, shared_));
+
+            return PipelineBuilder<In, Out>{ capacity_, std::move(stages_), std::move(input_), std::move(output), std::move(shared_) };
+        }
+
+        template<typename Fn>
+            requires std::invocable<Fn&, Cur&&>
+        auto stage(std::string name, usize parallelism, StageOrder order, Fn fn) && noexcept {
+            return std::move(*this).stage(std::move(name), parallelism, order, detail::no_state, detail::Stateless<Fn>{ std::move(fn) });
+        }
+
+        // Adds the final stage and starts all stage threads.
+        template<typename Init, typename Fn>
+            requires std::invocable<Init&> && std::invocable<Fn&, std::invoke_result_t<Init&>&, Cur&&>
+        std::unique_ptr<Pipeline<In>> sink(std::string name, usize parallelism, StageOrder order, Init init, Fn fn) && noexcept {
+            using State = std::invoke_result_t<Init&>;
+
+            stages_.push_back(std::make_unique<detail::Stage<Cur, void, State, Init, Fn>>(std::move(name), parallelism, order, std::move(init), std::move(fn), tail_, std::monostate{}, shared_));
+            return std::make_unique<Pipeline<In>>(std::move(stages_), std::move(input_), std::move(shared_));
+        }
+
+        template<typename Fn>
+            requires std::invocable<Fn&, Cur&&>
+        std::unique_ptr<Pipeline<In>> sink(std::string name, usize parallelism, StageOrder order, Fn fn) && noexcept {
+            return std::move(*this).sink(std::move(name), parallelism, order, detail::no_state, detail::Stateless<Fn>{ std::move(fn) });
+        }
+    };
+
+    /*
+    * Starts building a pipeline fed with values of type In. Every stage channel holds up to `capacity` items
+    * and at most `max_in_flight` items (0 means 4 * capacity) are inside the pipeline at any time,
+    * which also bounds the reorder buffers of in-order stages.
+    */
+    template<typename In>
+    PipelineBuilder<In, In> make_pipeline(usize capacity, usize max_in_flight = 0) noexcept {
+        auto input = std::make_shared<Channel<detail::Sequenced<In>>>(capacity);
+        auto shared = std::make_shared<detail::PipelineShared>(max_in_flight != 0 ? max_in_flight : 4 * capacity);
+        return PipelineBuilder<In, In>{ capacity, {}, input, input, std::move(shared) };
+    }
+}
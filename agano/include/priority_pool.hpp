@@ -0,0 +1,126 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fuwa/types.hpp>
+
+#include "channel.hpp"
+#include "thread_pool.hpp"
+
+namespace agano {
+    enum class DrainPolicy {
+        // Always run the highest pending class.
+        eStrict = 0,
+        // Share the workers between pending classes in proportion to their weights.
+        eWeighted,
+    };
+
+    struct PriorityPoolOptions {
+        usize thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+        // Class 0 is the highest priority.
+        usize class_count = 3;
+        // Workers that only ever run class 0 tasks, so latency-sensitive work never waits behind a long background task.
+        usize reserved_workers = 0;
+        DrainPolicy policy = DrainPolicy::eStrict;
+        // Per-class weights for eWeighted; empty means 2^(class_count - 1 - class).
+        std::vector<u32> weights{};
+        // A pending class that has not been served for this long is served next regardless of policy. Zero disables it.
+        std::chrono::milliseconds starvation_threshold{ 100 };
+    };
+
+    struct PriorityClassStats {
+        usize queued = 0;
+        u64 executed = 0;
+        std::chrono::nanoseconds mean_queue_time{};
+        std::chrono::nanoseconds max_queue_time{};
+    };
+
+    /*
+    * PriorityPool runs tasks tagged with a priority class. Every worker owns one FIFO per class; submissions
+    * from a worker stay local, others are spread round-robin, and idle workers steal from the others.
+    * Which class a worker serves next is decided by the drain policy, except that a class left unserved for
+    * longer than the starvation threshold goes first. Queue time (submit to start) is tracked per class.
+    */
+    class PriorityPool {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        struct Item {
+            UniqueTask fn;
+            Clock::time_point enqueued;
+        };
+
+        struct alignas(cache_line_size) Worker {
+            std::mutex mutex;
+            std::vector<std::deque<Item>> queues;
+            // Smooth weighted round-robin state; only touched by the owning thread.
+            std::vector<i64> current_weight;
+        };
+
+        struct alignas(cache_line_size) ClassState {
+            std::atomic<usize> pending{ 0 };
+            std::atomic<i64> last_served{ 0 };
+            std::atomic<u64> executed{ 0 };
+            std::atomic<u64> total_queue_ns{ 0 };
+            std::atomic<u64> max_queue_ns{ 0 };
+        };
+
+        PriorityPoolOptions options_;
+        std::unique_ptr<ClassState[]> classes_;
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::atomic<usize> next_worker_{ 0 };
+
+        std::mutex sleep_mutex_;
+        std::condition_variable general_cv_;
+        std::condition_variable reserved_cv_;
+        // Workers about to wait or waiting on each cv, so submit() only takes sleep_mutex_ when someone sleeps.
+        alignas(cache_line_size) std::atomic<usize> general_sleepers_{ 0 };
+        std::atomic<usize> reserved_sleepers_{ 0 };
+        bool stopping_ = false;
+
+        std::vector<std::thread> threads_;
+
+    public:
+        explicit PriorityPool(PriorityPoolOptions options = {}) noexcept;
+
+        PriorityPool(PriorityPool&&) noexcept = delete;
+        PriorityPool& operator=(PriorityPool&&) noexcept = delete;
+
+        PriorityPool(const PriorityPool&) = delete;
+        PriorityPool& operator=(const PriorityPool&) = delete;
+
+        // Runs every queued task before returning.
+        ~PriorityPool() noexcept;
+
+        template<Task F>
+        void submit(usize priority_class, F&& fn) noexcept {
+            push_(priority_class, UniqueTask{ std::forward<F>(fn) });
+        }
+
+        std::vector<PriorityClassStats> stats() const noexcept;
+
+        usize thread_count() const noexcept {
+            return threads_.size();
+        }
+
+        usize class_count() const noexcept {
+            return options_.class_count;
+        }
+
+    private:
+        void push_(usize priority_class, UniqueTask fn) noexcept;
+        bool has_work_(bool reserved) const noexcept;
+        usize pick_class_(Worker& worker, bool reserved) noexcept;
+        bool take_(usize index, usize priority_class, Item& item) noexcept;
+        void record_(usize priority_class, Clock::time_point enqueued) noexcept;
+        void worker_loop_(usize index) noexcept;
+    };
+}
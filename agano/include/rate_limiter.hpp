@@ -0,0 +1,141 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "common.hpp"
+
+namespace agano {
+    /*
+    * Token bucket whose whole state is one atomic word per shard: the (virtual) moment the bucket was empty.
+    * The tokens available at `now` are (now - empty_at) / cost, capped at the burst, so refill is computed
+    * lazily and taking tokens is a single CAS that moves empty_at forward. Time comes from a coarse clock.
+    * With shards > 1 the rate and burst are split between cache-line sized buckets and each thread starts
+    * from its own one; try_acquire() falls back to the other shards before failing.
+    */
+    class RateLimiter {
+    private:
+        // Time is kept in 1/16 ns so that per-token costs of a few nanoseconds stay accurate.
+        static constexpr u64 time_scale = 16u;
+
+        struct alignas(cache_line_size) Bucket {
+            std::atomic<u64> empty_at{ 0 };
+        };
+
+        std::unique_ptr<Bucket[]> buckets_;
+        usize shard_count_;
+        u64 cost_;
+        u64 window_;
+        u64 burst_;
+        u64 epoch_;
+
+    public:
+        // Refills `tokens_per_second` and holds at most `burst` tokens; it starts full.
+        RateLimiter(f64 tokens_per_second, u64 burst, usize shards = 1) noexcept
+            : buckets_{ std::make_unique<Bucket[]>(std::max<usize>(shards, 1u)) }
+            , shard_count_{ std::max<usize>(shards, 1u) }
+            , epoch_{ detail::coarse_now_ns() }
+        {
+            EH_ASSERT(tokens_per_second > 0.0, "Rate must be positive");
+            EH_ASSERT(burst > 0, "Burst must be positive");
+
+            const f64 shard_rate = tokens_per_second / static_cast<f64>(shard_count_);
+            cost_ = std::max<u64>(static_cast<u64>(std::llround(1e9 * time_scale / shard_rate)), 1u);
+            burst_ = std::max<u64>((burst + shard_count_ - 1) / shard_count_, 1u);
+            window_ = burst_ * cost_;
+        }
+
+        RateLimiter(RateLimiter&&) noexcept = delete;
+        RateLimiter& operator=(RateLimiter&&) noexcept = delete;
+
+        RateLimiter(const RateLimiter&) = delete;
+        RateLimiter& operator=(const RateLimiter&) = delete;
+
+        ~RateLimiter() noexcept = default;
+
+        // n above the per-shard burst (burst / shards, rounded up) never succeeds.
+        [[nodiscard]]
+        bool try_acquire(u64 n = 1) noexcept {
+            if (n == 0) {
+                return true;
+            }
+
+            const u64 now = now_();
+            const usize home = detail::thread_shard_seed() % shard_count_;
+            for (usize i = 0; i < shard_count_; ++i) {
+                if (try_take_(buckets_[(home + i) % shard_count_], n, now)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Reserves n tokens on the thread's shard (going into debt if needed) and sleeps until they are refilled.
+        // Waiters are served in reservation order. Requests above the per-shard burst are allowed and just wait longer.
+        void acquire(u64 n = 1) noexcept {
+            if (n == 0 || try_acquire(n)) {
+                return;
+            }
+
+            const u64 now = now_();
+            Bucket& bucket = buckets_[detail::thread_shard_seed() % shard_count_];
+
+            u64 empty_at = bucket.empty_at.load(std::memory_order_relaxed);
+            u64 next = 0;
+            do {
+                next = std::max(empty_at, now - window_) + n * cost_;
+            } while (!bucket.empty_at.compare_exchange_weak(empty_at, next, std::memory_order_relaxed));
+
+            if (next > now) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds{ (next - now) / time_scale });
+            }
+        }
+
+        // Approximate number of tokens available right now, summed over shards.
+        u64 available() const noexcept {
+            const u64 now = now_();
+            u64 total = 0;
+            for (usize i = 0; i < shard_count_; ++i) {
+                const u64 empty_at = buckets_[i].empty_at.load(std::memory_order_relaxed);
+                if (now > empty_at) {
+                    total += std::min((now - empty_at) / cost_, burst_);
+                }
+            }
+            return total;
+        }
+
+        usize shard_count() const noexcept {
+            return shard_count_;
+        }
+
+    private:
+        // Offset by one window so that empty_at == 0 means "full" and now - window_ never underflows.
+        u64 now_() const noexcept {
+            return (detail::coarse_now_ns() - epoch_) * time_scale + window_;
+        }
+
+        bool try_take_(Bucket& bucket, u64 n, u64 now) const noexcept {
+            if (n > burst_) {
+                return false;
+            }
+
+            const u64 need = n * cost_;
+            u64 empty_at = bucket.empty_at.load(std::memory_order_relaxed);
+            while (true) {
+                const u64 next = std::max(empty_at, now - window_) + need;
+                if (next > now) {
+                    return false;
+                }
+                if (bucket.empty_at.compare_exchange_weak(empty_at, next, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,324 @@
+#pragma once
+#include <atomic>
+#include <concepts>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "agano.hpp"
+#include "common.hpp"
+
+namespace agano {
+    /*
+    * Handle to an element of a slot map: slot index in the low 32 bits, generation in the high 32 bits.
+    * A handle whose element was erased stops resolving even if the slot is reused, because the slot's
+    * generation has moved on. The default handle never resolves.
+    */
+    class SlotHandle {
+    private:
+        u64 value_ = std::numeric_limits<u64>::max();
+
+    public:
+        constexpr SlotHandle() noexcept = default;
+
+        constexpr SlotHandle(u32 index, u32 generation) noexcept
+            : value_{ (static_cast<u64>(generation) << 32u) | index }
+        {}
+
+        static constexpr SlotHandle from_raw(u64 value) noexcept {
+            SlotHandle handle;
+            handle.value_ = value;
+            return handle;
+        }
+
+        constexpr u32 index() const noexcept {
+            return static_cast<u32>(value_);
+        }
+
+        constexpr u32 generation() const noexcept {
+            return static_cast<u32>(value_ >> 32u);
+        }
+
+        constexpr u64 raw() const noexcept {
+            return value_;
+        }
+
+        constexpr bool operator==(const SlotHandle&) const noexcept = default;
+    };
+
+    /*
+    * Single-owner slot map. Values are packed densely in one vector (erase moves the last value into the hole),
+    * so iterating over them is a linear scan; slots map handles to dense positions. No atomics, not thread-safe:
+    * share it through Synced or pin it to a thread with ThreadBoundSlotMap.
+    */
+    template<std::movable T>
+    class SlotMap {
+    private:
+        static constexpr u32 npos = std::numeric_limits<u32>::max();
+
+        struct Slot {
+            // Odd while occupied.
+            u32 generation = 0;
+            // Dense position while occupied, next free slot otherwise.
+            u32 link = npos;
+        };
+
+        std::vector<T> values_;
+        std::vector<u32> owners_;
+        std::vector<Slot> slots_;
+        u32 free_head_ = npos;
+
+    public:
+        SlotMap() noexcept = default;
+
+        SlotHandle insert(T value) noexcept {
+            u32 index = free_head_;
+            if (index != npos) {
+                free_head_ = slots_[index].link;
+            }
+            else {
+                EH_ASSERT(slots_.size() < npos, "SlotMap is full");
+                index = static_cast<u32>(slots_.size());
+                slots_.emplace_back();
+            }
+
+            Slot& slot = slots_[index];
+            ++slot.generation;
+            slot.link = static_cast<u32>(values_.size());
+            values_.push_back(std::move(value));
+            owners_.push_back(index);
+            return SlotHandle{ index, slot.generation };
+        }
+
+        // Returns the erased value, or std::nullopt if the handle is stale.
+        std::optional<T> erase(SlotHandle handle) noexcept {
+            if (!contains(handle)) {
+                return std::nullopt;
+            }
+
+            Slot& slot = slots_[handle.index()];
+            const u32 position = slot.link;
+            std::optional<T> value{ std::move(values_[position]) };
+
+            if (position + 1 != values_.size()) {
+                values_[position] = std::move(values_.back());
+                owners_[position] = owners_.back();
+                slots_[owners_[position]].link = position;
+            }
+            values_.pop_back();
+            owners_.pop_back();
+
+            ++slot.generation;
+            slot.link = free_head_;
+            free_head_ = handle.index();
+            return value;
+        }
+
+        bool contains(SlotHandle handle) const noexcept {
+            return handle.index() < slots_.size() && slots_[handle.index()].generation == handle.generation() && (handle.generation() & 1u) != 0;
+        }
+
+        T* get(SlotHandle handle) noexcept {
+            return contains(handle) ? &values_[slots_[handle.index()].link] : nullptr;
+        }
+
+        const T* get(SlotHandle handle) const noexcept {
+            return contains(handle) ? &values_[slots_[handle.index()].link] : nullptr;
+        }
+
+        usize size() const noexcept {
+            return values_.size();
+        }
+
+        bool empty() const noexcept {
+            return values_.empty();
+        }
+
+        // Dense storage, in no particular order. Erasing invalidates pointers into it.
+        std::span<T> values() noexcept {
+            return values_;
+        }
+
+        std::span<const T> values() const noexcept {
+            return values_;
+        }
+
+        // Handle of the value at a dense position, e.g. while iterating over values().
+        SlotHandle handle_at(usize position) const noexcept {
+            const u32 index = owners_[position];
+            return SlotHandle{ index, slots_[index].generation };
+        }
+    };
+
+    // Slot map owned by one thread at a time; any access from another thread panics.
+    template<std::movable T>
+    using ThreadBoundSlotMap = ThreadBound<SlotMap<T>>;
+
+    /*
+    * ConcurrentSlotMap is a fixed-capacity slot map for many threads. Slots live in one contiguous array;
+    * free slots form a lock-free (tagged Treiber) stack, get() is wait-free: one generation load and compare.
+    * Insert and erase never lock. A value is destroyed by erase(), so the caller must make sure no other
+    * thread is still using a pointer obtained through the same handle (e.g. erase only from the owner).
+    *
+    * Unlike SlotMap, values are not kept dense: each value stays in its slot, and for_each() skips the holes
+    * left by erase(). Packing them would mean moving a value on every erase, under readers that hold plain
+    * pointers into it. Freed slots are reused before new ones, so the occupied slots stay in the prefix up to
+    * the most slots ever in use at once.
+    */
+    template<std::movable T>
+    class ConcurrentSlotMap {
+    private:
+        static constexpr u32 npos = std::numeric_limits<u32>::max();
+
+        struct Slot {
+            // Odd while occupied.
+            std::atomic<u32> generation{ 0 };
+            std::atomic<u32> next_free{ npos };
+            alignas(T) std::byte storage[sizeof(T)];
+
+            T* get() noexcept {
+                return std::launder(reinterpret_cast<T*>(storage));
+            }
+        };
+
+        std::unique_ptr<Slot[]> slots_;
+        u32 capacity_;
+        // Tag in the high 32 bits defeats ABA on the free stack.
+        alignas(cache_line_size) std::atomic<u64> free_head_{ npos };
+        alignas(cache_line_size) std::atomic<u32> used_{ 0 };
+        alignas(cache_line_size) std::atomic<usize> size_{ 0 };
+
+    public:
+        explicit ConcurrentSlotMap(u32 capacity) noexcept
+            : slots_{ std::make_unique<Slot[]>(capacity) }
+            , capacity_{ capacity }
+        {
+            EH_ASSERT(capacity < npos, "ConcurrentSlotMap capacity is too large");
+        }
+
+        ConcurrentSlotMap(ConcurrentSlotMap&&) noexcept = delete;
+        ConcurrentSlotMap& operator=(ConcurrentSlotMap&&) noexcept = delete;
+
+        ConcurrentSlotMap(const ConcurrentSlotMap&) = delete;
+        ConcurrentSlotMap& operator=(const ConcurrentSlotMap&) = delete;
+
+        ~ConcurrentSlotMap() noexcept {
+            for (u32 i = 0; i < high_water_(); ++i) {
+                if ((slots_[i].generation.load(std::memory_order_acquire) & 1u) != 0) {
+                    slots_[i].get()->~T();
+                }
+            }
+        }
+
+        // std::nullopt when every slot is taken.
+        [[nodiscard]]
+        std::optional<SlotHandle> insert(T value) noexcept {
+            u32 index = pop_free_();
+            if (index == npos) {
+                index = used_.fetch_add(1, std::memory_order_relaxed);
+                if (index >= capacity_) {
+                    used_.fetch_sub(1, std::memory_order_relaxed);
+                    return std::nullopt;
+                }
+            }
+
+            Slot& slot = slots_[index];
+            new (slot.storage) T(std::move(value));
+            const u32 generation = slot.generation.load(std::memory_order_relaxed) + 1u;
+            slot.generation.store(generation, std::memory_order_release);
+            size_.fetch_add(1, std::memory_order_relaxed);
+            return SlotHandle{ index, generation };
+        }
+
+        // Returns false if the handle is stale or another thread erased it first.
+        bool erase(SlotHandle handle) noexcept {
+            if (handle.index() >= high_water_() || (handle.generation() & 1u) == 0) {
+                return false;
+            }
+
+            Slot& slot = slots_[handle.index()];
+            u32 expected = handle.generation();
+            if (!slot.generation.compare_exchange_strong(expected, expected + 1u, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                return false;
+            }
+
+            slot.get()->~T();
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            push_free_(handle.index());
+            return true;
+        }
+
+        T* get(SlotHandle handle) noexcept {
+            if (handle.index() >= high_water_()) {
+                return nullptr;
+            }
+
+            Slot& slot = slots_[handle.index()];
+            return slot.generation.load(std::memory_order_acquire) == handle.generation() && (handle.generation() & 1u) != 0 ? slot.get() : nullptr;
+        }
+
+        const T* get(SlotHandle handle) const noexcept {
+            return const_cast<ConcurrentSlotMap*>(this)->get(handle);
+        }
+
+        bool contains(SlotHandle handle) const noexcept {
+            return get(handle) != nullptr;
+        }
+
+        usize size() const noexcept {
+            return size_.load(std::memory_order_relaxed);
+        }
+
+        u32 capacity() const noexcept {
+            return capacity_;
+        }
+
+        // Calls fn(handle, value) for every occupied slot in slot order; the same erase caveat as get() applies.
+        template<typename Fn>
+            requires std::invocable<Fn&, SlotHandle, T&>
+        void for_each(Fn&& fn) noexcept {
+            const u32 end = high_water_();
+            for (u32 i = 0; i < end; ++i) {
+                const u32 generation = slots_[i].generation.load(std::memory_order_acquire);
+                if ((generation & 1u) != 0) {
+                    fn(SlotHandle{ i, generation }, *slots_[i].get());
+                }
+            }
+        }
+
+    private:
+        u32 high_water_() const noexcept {
+            return std::min(used_.load(std::memory_order_acquire), capacity_);
+        }
+
+        u32 pop_free_() noexcept {
+            u64 head = free_head_.load(std::memory_order_acquire);
+            while (static_cast<u32>(head) != npos) {
+                const u32 index = static_cast<u32>(head);
+                const u64 next = ((head & ~u64{ npos }) + (u64{ 1 } << 32u)) | slots_[index].next_free.load(std::memory_order_relaxed);
+                if (free_head_.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+                    return index;
+                }
+            }
+            return npos;
+        }
+
+        void push_free_(u32 index) noexcept {
+            u64 head = free_head_.load(std::memory_order_relaxed);
+            while (true) {
+                slots_[index].next_free.store(static_cast<u32>(head), std::memory_order_relaxed);
+                const u64 next = ((head & ~u64{ npos }) + (u64{ 1 } << 32u)) | index;
+                if (free_head_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed)) {
+                    return;
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,196 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "common.hpp"
+#include "concurrent_vector.hpp"
+
+namespace agano {
+    /*
+    * StringInterner maps strings to dense u32 ids, starting from 0, and back. Looking up a string that is
+    * already interned never locks: it probes an open-addressing table of atomic words (hash tag + id) and
+    * compares against the stored string. A new string is first copied into the calling thread's arena, then
+    * a short critical section assigns its id and publishes it; a full table is replaced by a twice larger one
+    * while readers keep probing the old one. Ids and string_views stay valid for the interner's lifetime.
+    */
+    class StringInterner {
+    private:
+        struct Table {
+            std::unique_ptr<std::atomic<u64>[]> slots;
+            usize mask;
+            usize used = 0;
+
+            explicit Table(usize capacity) noexcept
+                : slots{ std::make_unique<std::atomic<u64>[]>(capacity) }
+                , mask{ capacity - 1 }
+            {}
+        };
+
+        struct alignas(cache_line_size) Arena {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<char[]>> chunks;
+            char* cursor = nullptr;
+            usize remaining = 0;
+        };
+
+        static constexpr usize arena_chunk_size = 64u << 10u;
+        static constexpr usize min_table_capacity = 64u;
+
+        alignas(cache_line_size) std::atomic<Table*> table_;
+        ConcurrentVector<std::string_view> strings_;
+
+        alignas(cache_line_size) std::mutex writer_mutex_;
+        // Every table ever published; readers may still be probing a replaced one.
+        std::vector<std::unique_ptr<Table>> tables_;
+
+        std::unique_ptr<Arena[]> arenas_;
+        usize arena_count_;
+
+    public:
+        explicit StringInterner(usize expected_strings = 0) noexcept
+            : arena_count_{ std::max(std::thread::hardware_concurrency(), 1u) }
+        {
+            tables_.push_back(std::make_unique<Table>(std::bit_ceil(std::max(expected_strings * 2, min_table_capacity))));
+            table_.store(tables_.back().get(), std::memory_order_release);
+            arenas_ = std::make_unique<Arena[]>(arena_count_);
+        }
+
+        StringInterner(StringInterner&&) noexcept = delete;
+        StringInterner& operator=(StringInterner&&) noexcept = delete;
+
+        StringInterner(const StringInterner&) = delete;
+        StringInterner& operator=(const StringInterner&) = delete;
+
+        // Id of str, interning it first if needed.
+        u32 intern(std::string_view str) noexcept {
+            const u64 hash = hash_(str);
+            if (const auto id = find_(*table_.load(std::memory_order_acquire), str, hash)) {
+                return *id;
+            }
+
+            // Copy outside the writer lock. If another thread interns the same string meanwhile, this copy is wasted.
+            const std::string_view stored = store_(str);
+
+            std::lock_guard lock{ writer_mutex_ };
+            Table* table = table_.load(std::memory_order_relaxed);
+            if (const auto id = find_(*table, str, hash)) {
+                return *id;
+            }
+
+            EH_ASSERT(strings_.size() < std::numeric_limits<u32>::max(), "StringInterner is full");
+            if ((table->used + 1) * 2 > table->mask + 1) {
+                table = grow_(*table);
+            }
+
+            // The string is published before its slot, so a reader that finds the slot can compare against it.
+            const u32 id = static_cast<u32>(strings_.push_back(stored));
+            insert_(*table, hash, id);
+            return id;
+        }
+
+        // Id of str if it has been interned. Never locks.
+        std::optional<u32> find(std::string_view str) const noexcept {
+            return find_(*table_.load(std::memory_order_acquire), str, hash_(str));
+        }
+
+        // The interned string with the given id; valid as long as the interner.
+        std::string_view view(u32 id) const noexcept {
+            return strings_[id];
+        }
+
+        usize size() const noexcept {
+            return strings_.size();
+        }
+
+    private:
+        static u64 hash_(std::string_view str) noexcept {
+            return static_cast<u64>(std::hash<std::string_view>{}(str));
+        }
+
+        // Slot word: upper half is a hash tag, lower half is id + 1 so that zero means empty.
+        static u64 slot_value_(u64 hash, u32 id) noexcept {
+            return (hash & ~u64{ std::numeric_limits<u32>::max() }) | (static_cast<u64>(id) + 1u);
+        }
+
+        std::optional<u32> find_(const Table& table, std::string_view str, u64 hash) const noexcept {
+            const u64 tag = hash >> 32u;
+            for (usize i = static_cast<usize>(hash) & table.mask;; i = (i + 1) & table.mask) {
+                const u64 slot = table.slots[i].load(std::memory_order_acquire);
+                if (slot == 0) {
+                    return std::nullopt;
+                }
+
+                const u32 id = static_cast<u32>(slot) - 1u;
+                if ((slot >> 32u) == tag && strings_[id] == str) {
+                    return id;
+                }
+            }
+        }
+
+        static void insert_(Table& table, u64 hash, u32 id) noexcept {
+            usize i = static_cast<usize>(hash) & table.mask;
+            while (table.slots[i].load(std::memory_order_relaxed) != 0) {
+                i = (i + 1) & table.mask;
+            }
+            table.slots[i].store(slot_value_(hash, id), std::memory_order_release);
+            ++table.used;
+        }
+
+        Table* grow_(const Table& table) noexcept {
+            auto fresh = std::make_unique<Table>((table.mask + 1) * 2);
+            for (usize i = 0; i <= table.mask; ++i) {
+                const u64 slot = table.slots[i].load(std::memory_order_relaxed);
+                if (slot != 0) {
+                    const u32 id = static_cast<u32>(slot) - 1u;
+                    insert_(*fresh, hash_(strings_[id]), id);
+                }
+            }
+
+            Table* published = fresh.get();
+            tables_.push_back(std::move(fresh));
+            table_.store(published, std::memory_order_release);
+            return published;
+        }
+
+        std::string_view store_(std::string_view str) noexcept {
+            if (str.empty()) {
+                return std::string_view{};
+            }
+
+            Arena& arena = arenas_[detail::thread_shard_seed() % arena_count_];
+            std::lock_guard lock{ arena.mutex };
+
+            // Strings bigger than a quarter chunk get their own allocation, so chunks are not abandoned half empty.
+            if (str.size() > arena_chunk_size / 4) {
+                arena.chunks.push_back(std::make_unique<char[]>(str.size()));
+                std::memcpy(arena.chunks.back().get(), str.data(), str.size());
+                return std::string_view{ arena.chunks.back().get(), str.size() };
+            }
+
+            if (arena.remaining < str.size()) {
+                arena.chunks.push_back(std::make_unique<char[]>(arena_chunk_size));
+                arena.cursor = arena.chunks.back().get();
+                arena.remaining = arena_chunk_size;
+            }
+
+            char* data = arena.cursor;
+            std::memcpy(data, str.data(), str.size());
+            arena.cursor += str.size();
+            arena.remaining -= str.size();
+            return std::string_view{ data, str.size() };
+        }
+    };
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <initializer_list>
+#include <thread>
+#include <vector>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "thread_pool.hpp"
+#include "wait_strategy.hpp"
+
+namespace agano {
+    /*
+    * TaskGraph is a reusable DAG of tasks. Every node declares its predecessors when it is added,
+    * so the graph is acyclic by construction. During run() each node owns an atomic counter of
+    * unfinished predecessors; the thread that finishes the last predecessor releases the node
+    * immediately, running one released successor inline and submitting the rest to the pool.
+    * Repeated runs only reset counters and never reallocate the graph.
+    * A graph must not be modified or run concurrently with itself.
+    */
+    class TaskGraph {
+    public:
+        using NodeId = usize;
+
+    private:
+        static constexpr NodeId no_node = static_cast<NodeId>(-1);
+
+        struct Node {
+            UniqueTask fn;
+            std::vector<NodeId> successors;
+            usize predecessor_count = 0;
+            std::atomic<usize> pending{ 0 };
+        };
+
+        std::deque<Node> nodes_;
+        std::vector<NodeId> roots_;
+
+        static constexpr u32 running = 0u;
+        static constexpr u32 notifying = 1u;
+        static constexpr u32 finished = 2u;
+
+        std::atomic<usize> remaining_{ 0 };
+        // The last node to finish moves this to notifying, wakes run() and then to finished,
+        // after which it no longer touches *this.
+        std::atomic<u32> state_{ finished };
+
+    public:
+        TaskGraph() noexcept = default;
+
+        TaskGraph(TaskGraph&&) noexcept = delete;
+        TaskGraph& operator=(TaskGraph&&) noexcept = delete;
+
+        TaskGraph(const TaskGraph&) = delete;
+        TaskGraph& operator=(const TaskGraph&) = delete;
+
+        ~TaskGraph() noexcept = default;
+
+        // Constrained on Task like ThreadPool::submit rather than on Send: send_tag_v is opt-in per type,
+        // and a closure's type is unnamed, so no lambda could ever satisfy Send.
+        template<Task F>
+        NodeId add(F&& fn, std::initializer_list<NodeId> predecessors = {}) noexcept {
+            const NodeId id = nodes_.size();
+            Node& node = nodes_.emplace_back();
+            node.fn = std::forward<F>(fn);
+            node.predecessor_count = predecessors.size();
+
+            for (NodeId predecessor : predecessors) {
+                EH_ASSERT(predecessor < id, "A predecessor must be added to the graph before its successors");
+                nodes_[predecessor].successors.push_back(id);
+            }
+
+            if (predecessors.size() == 0) {
+                roots_.push_back(id);
+            }
+
+            return id;
+        }
+
+        usize size() const noexcept {
+            return nodes_.size();
+        }
+
+        // Runs every node once and waits, with the given strategy, until the whole graph has finished.
+        template<WaitStrategy Wait = BlockingWait>
+        void run(ThreadPool& pool, Wait wait = {}) noexcept {
+            if (nodes_.empty()) {
+                return;
+            }
+
+            for (Node& node : nodes_) {
+                node.pending.store(node.predecessor_count, std::memory_order_relaxed);
+            }
+            remaining_.store(nodes_.size(), std::memory_order_relaxed);
+            // Published to the workers by the pool's queue.
+            state_.store(running, std::memory_order_relaxed);
+
+            for (usize i = 1; i < roots_.size(); ++i) {
+                pool.submit([this, &pool, id = roots_[i]] { execute_(pool, id); });
+            }
+            execute_(pool, roots_.front());
+
+            if (pool.owns_current_thread()) {
+                while (remaining_.load(std::memory_order_acquire) != 0) {
+                    if (!pool.try_run_one()) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+
+            u32 state = state_.load(std::memory_order_acquire);
+            while (state == running) {
+                wait.wait(state_, running);
+                state = state_.load(std::memory_order_acquire);
+            }
+            // The last finisher is between its store and its notify; it is done with *this a moment later.
+            while (state != finished) {
+                cpu_relax();
+                state = state_.load(std::memory_order_acquire);
+            }
+        }
+
+        void run() noexcept {
+            run(global_pool());
+        }
+
+    private:
+        void execute_(ThreadPool& pool, NodeId id) noexcept {
+            while (id != no_node) {
+                Node& node = nodes_[id];
+                node.fn();
+
+                id = no_node;
+                for (NodeId successor : node.successors) {
+                    if (nodes_[successor].pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                        continue;
+                    }
+
+                    if (id == no_node) {
+                        id = successor;
+                    }
+                    else {
+                        pool.submit([this, &pool, successor] { execute_(pool, successor); });
+                    }
+                }
+
+                if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    // run() picks the strategy, so notify the way a parking one needs; it is cheap when nobody sleeps.
+                    state_.store(notifying, std::memory_order_release);
+                    state_.notify_all();
+                    state_.store(finished, std::memory_order_release);
+                }
+            }
+        }
+    };
+}
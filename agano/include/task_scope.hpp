@@ -0,0 +1,154 @@
+#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <variant>
+
+#include <fuwa/types.hpp>
+#include <fuwa/result.hpp>
+
+#include "thread_pool.hpp"
+
+namespace agano {
+    template<typename F>
+    concept StoppableTask = Task<F> || (std::invocable<std::remove_cvref_t<F>&, std::stop_token> && std::move_constructible<std::remove_cvref_t<F>>);
+
+    namespace detail {
+        template<typename T, typename E>
+        inline constexpr bool is_result_of_v = false;
+
+        template<typename Res, typename E>
+        inline constexpr bool is_result_of_v<eh::Result<Res, E>, E> = true;
+    }
+
+    /*
+    * TaskScope<E> runs tasks on a pool and joins all of them before it goes away.
+    * A task is invoked with the scope's std::stop_token (or with no arguments) and returns void or eh::Result<R, E>.
+    * The first task that returns an error requests stop, so its siblings can return early, whether they poll
+    * the token or block in Synced::lock_when or Channel::push/pop. Tasks that have not started yet are skipped.
+    * join() returns the first error.
+    */
+    template<eh::ErrorType E>
+    class TaskScope {
+    private:
+        ThreadPool& pool_;
+        std::stop_source stop_;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        usize pending_ = 0;
+        std::optional<E> first_error_;
+
+    public:
+        explicit TaskScope(ThreadPool& pool = global_pool()) noexcept
+            : pool_{ pool }
+        {}
+
+        TaskScope(TaskScope&&) noexcept = delete;
+        TaskScope& operator=(TaskScope&&) noexcept = delete;
+
+        TaskScope(const TaskScope&) = delete;
+        TaskScope& operator=(const TaskScope&) = delete;
+
+        ~TaskScope() noexcept {
+            static_cast<void>(join());
+        }
+
+        template<StoppableTask Fn>
+        void spawn(Fn&& fn) noexcept {
+            {
+                std::lock_guard lock{ mutex_ };
+                ++pending_;
+            }
+
+            pool_.submit([this, fn = std::forward<Fn>(fn)]() mutable {
+                std::optional<E> error;
+                if (!stop_.stop_requested()) {
+                    error = run_(fn);
+                }
+                finish_(error);
+            });
+        }
+
+        std::stop_token token() const noexcept {
+            return stop_.get_token();
+        }
+
+        void cancel() noexcept {
+            stop_.request_stop();
+        }
+
+        // Waits for every spawned task. Safe to call more than once.
+        eh::Result<std::monostate, E> join() noexcept {
+            if (pool_.owns_current_thread()) {
+                while (!is_idle_()) {
+                    if (!pool_.try_run_one()) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+
+            std::unique_lock lock{ mutex_ };
+            cv_.wait(lock, [this] { return pending_ == 0; });
+
+            if (first_error_) {
+                return eh::Error<E>{ *first_error_ };
+            }
+            return std::monostate{};
+        }
+
+    private:
+        template<typename Fn>
+        std::optional<E> run_(Fn& fn) noexcept {
+            auto call = [&] {
+                if constexpr (std::invocable<Fn&, std::stop_token>) {
+                    return fn(stop_.get_token());
+                }
+                else {
+                    return fn();
+                }
+            };
+
+            using Ret = decltype(call());
+            static_assert(std::is_void_v<Ret> || detail::is_result_of_v<Ret, E>, "A scoped task must return void or eh::Result<R, E>");
+
+            std::optional<E> error;
+            if constexpr (std::is_void_v<Ret>) {
+                call();
+            }
+            else {
+                call().match([](auto&&) {}, [&error](E value) { error = value; });
+            }
+            return error;
+        }
+
+        void finish_(const std::optional<E>& error) noexcept {
+            bool first = false;
+            if (error) {
+                std::lock_guard lock{ mutex_ };
+                if (!first_error_) {
+                    first_error_ = error;
+                    first = true;
+                }
+            }
+
+            // Stop callbacks run synchronously here, so this must happen outside of mutex_.
+            if (first) {
+                stop_.request_stop();
+            }
+
+            std::lock_guard lock{ mutex_ };
+            if (--pending_ == 0) {
+                cv_.notify_all();
+            }
+        }
+
+        bool is_idle_() noexcept {
+            std::lock_guard lock{ mutex_ };
+            return pending_ == 0;
+        }
+    };
+}
@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+namespace agano {
+    template<typename F>
+    concept Task = std::invocable<std::remove_cvref_t<F>&> && std::move_constructible<std::remove_cvref_t<F>>;
+
+    /*
+    * UniqueTask is a type-erased void() callable that only needs to be movable, so a Task may own
+    * move-only state (unique_ptr, promise, ...). Callables up to three pointers in size that can be moved
+    * without throwing are stored inline, bigger ones on the heap. Calling an empty task panics.
+    */
+    class UniqueTask {
+    private:
+        static constexpr usize inline_size = 3 * sizeof(void*);
+
+        struct VTable {
+            void (*invoke)(void* storage) noexcept;
+            // Move-constructs the callable into to and destroys the one in from.
+            void (*relocate)(void* from, void* to) noexcept;
+            void (*destroy)(void* storage) noexcept;
+        };
+
+        template<typename F>
+        static constexpr bool stored_inline = sizeof(F) <= inline_size
+            && alignof(F) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<F>;
+
+        template<typename F>
+        static constexpr VTable inline_vtable{
+            [](void* storage) noexcept { (*std::launder(static_cast<F*>(storage)))(); },
+            [](void* from, void* to) noexcept {
+                F* source = std::launder(static_cast<F*>(from));
+                ::new (to) F(std::move(*source));
+                source->~F();
+            },
+            [](void* storage) noexcept { std::launder(static_cast<F*>(storage))->~F(); },
+        };
+
+        template<typename F>
+        static constexpr VTable heap_vtable{
+            [](void* storage) noexcept { (**static_cast<F**>(storage))(); },
+            [](void* from, void* to) noexcept { ::new (to) F*(*static_cast<F**>(from)); },
+            [](void* storage) noexcept { delete *static_cast<F**>(storage); },
+        };
+
+        alignas(std::max_align_t) std::byte storage_[inline_size];
+        const VTable* vtable_ = nullptr;
+
+    public:
+        UniqueTask() noexcept = default;
+
+        template<Task F>
+            requires (!std::same_as<std::remove_cvref_t<F>, UniqueTask>)
+        UniqueTask(F&& fn) noexcept {
+            using Fn = std::remove_cvref_t<F>;
+            if constexpr (stored_inline<Fn>) {
+                ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(fn));
+                vtable_ = &inline_vtable<Fn>;
+            }
+            else {
+                ::new (static_cast<void*>(storage_)) Fn*(new Fn(std::forward<F>(fn)));
+                vtable_ = &heap_vtable<Fn>;
+            }
+        }
+
+        UniqueTask(UniqueTask&& rhs) noexcept
+            : vtable_{ std::exchange(rhs.vtable_, nullptr) }
+        {
+            if (vtable_ != nullptr) {
+                vtable_->relocate(rhs.storage_, storage_);
+            }
+        }
+
+        UniqueTask& operator=(UniqueTask&& rhs) noexcept {
+            if (this != &rhs) {
+                reset_();
+                vtable_ = std::exchange(rhs.vtable_, nullptr);
+                if (vtable_ != nullptr) {
+                    vtable_->relocate(rhs.storage_, storage_);
+                }
+            }
+            return *this;
+        }
+
+        UniqueTask(const UniqueTask&) = delete;
+        UniqueTask& operator=(const UniqueTask&) = delete;
+
+        ~UniqueTask() noexcept {
+            reset_();
+        }
+
+        void operator()() noexcept {
+            EH_ASSERT(vtable_ != nullptr, "Called an empty UniqueTask");
+            vtable_->invoke(storage_);
+        }
+
+        explicit operator bool() const noexcept {
+            return vtable_ != nullptr;
+        }
+
+    private:
+        void reset_() noexcept {
+            if (vtable_ != nullptr) {
+                vtable_->destroy(storage_);
+                vtable_ = nullptr;
+            }
+        }
+    };
+
+    /*
+    * ThreadPool is a fixed set of worker threads draining one shared FIFO of tasks.
+    * A thread that waits for pool work (see parallel_for) may call try_run_one() to help
+    * instead of sleeping, so nested parallel calls from inside a worker do not deadlock.
+    */
+    class ThreadPool {
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<UniqueTask> tasks_;
+        std::vector<std::thread> workers_;
+        bool stopping_ = false;
+
+    public:
+        explicit ThreadPool(usize thread_count = std::max(std::thread::hardware_concurrency(), 1u)) noexcept;
+
+        ThreadPool(ThreadPool&&) noexcept = delete;
+        ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool() noexcept;
+
+        template<Task F>
+        void submit(F&& fn) noexcept {
+            push_(UniqueTask{ std::forward<F>(fn) });
+        }
+
+        bool try_run_one() noexcept;
+
+        // True when called from one of this pool's workers. Such callers must help instead of blocking.
+        bool owns_current_thread() const noexcept;
+
+        usize thread_count() const noexcept {
+            return workers_.size();
+        }
+
+    private:
+        void push_(UniqueTask task) noexcept;
+        void worker_loop_() noexcept;
+    };
+
+    ThreadPool& global_pool() noexcept;
+
+    /*
+    * Calls fn(i) for every i in [0, count) on the pool and returns once all calls are done.
+    * Indices are claimed dynamically, and the calling thread claims them too.
+    */
+    template<typename Fn>
+        requires std::invocable<Fn&, usize>
+    void parallel_for(ThreadPool& pool, usize count, Fn&& fn) noexcept {
+        if (count == 0) {
+            return;
+        }
+
+        if (count == 1 || pool.thread_count() == 0) {
+            for (usize i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        struct State {
+            std::atomic<usize> next{ 0 };
+            std::atomic<usize> completed{ 0 };
+        };
+
+        auto state = std::make_shared<State>();
+        auto body = [state, &fn, count] {
+            usize done = 0;
+            for (usize i = state->next.fetch_add(1, std::memory_order_relaxed); i < count; i = state->next.fetch_add(1, std::memory_order_relaxed)) {
+                fn(i);
+                ++done;
+            }
+
+            if (done != 0 && state->completed.fetch_add(done, std::memory_order_acq_rel) + done == count) {
+                state->completed.notify_all();
+            }
+        };
+
+        const usize helpers = std::min(pool.thread_count(), count - 1);
+        for (usize i = 0; i < helpers; ++i) {
+            pool.submit(body);
+        }
+        body();
+
+        for (usize done = state->completed.load(std::memory_order_acquire); done != count; done = state->completed.load(std::memory_order_acquire)) {
+            state->completed.wait(done, std::memory_order_acquire);
+        }
+    }
+
+    template<typename Fn>
+        requires std::invocable<Fn&, usize>
+    void parallel_for(usize count, Fn&& fn) noexcept {
+        parallel_for(global_pool(), count, std::forward<Fn>(fn));
+    }
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include <fuwa/types.hpp>
+
+#include "agano.hpp"
+#include "channel.hpp"
+#include "thread_pool.hpp"
+
+namespace agano {
+    /*
+    * TimerWheel is a hierarchical timing wheel (4 levels of 256 slots) serviced by its own thread.
+    * Scheduling and cancelling a timer are O(1): timers live in a slab and are linked into the slot of
+    * their expiry tick; coarser levels are cascaded down as time advances. The service thread sleeps until
+    * the next tick that fires a timer or cascades a slot, not every tick. Callbacks run on the
+    * service thread, outside of the wheel lock, so they must be short (e.g. wake a waiter).
+    */
+    class TimerWheel {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using TimerId = u64;
+
+        static constexpr TimerId invalid_timer = std::numeric_limits<TimerId>::max();
+
+    private:
+        static constexpr usize level_bits = 8u;
+        static constexpr usize slots_per_level = usize{ 1 } << level_bits;
+        static constexpr usize level_count = 4u;
+        static constexpr u32 npos = std::numeric_limits<u32>::max();
+        static constexpr u64 no_tick = std::numeric_limits<u64>::max();
+
+        struct Node {
+            u64 expires = 0;
+            u32 prev = npos;
+            u32 next = npos;
+            u32 generation = 0;
+            u32 bucket = npos;
+            UniqueTask fn;
+        };
+
+        Clock::duration tick_;
+        Clock::time_point epoch_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<Node> nodes_;
+        u32 free_head_ = npos;
+        std::array<u32, level_count * slots_per_level> buckets_;
+        u64 current_ = 0;
+        // Tick the sleeping service thread will wake up at; a timer due earlier has to notify it.
+        u64 wake_tick_ = no_tick;
+        usize active_ = 0;
+        bool stopping_ = false;
+
+        std::thread thread_;
+
+    public:
+        explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds{ 1 }) noexcept;
+
+        TimerWheel(TimerWheel&&) noexcept = delete;
+        TimerWheel& operator=(TimerWheel&&) noexcept = delete;
+
+        TimerWheel(const TimerWheel&) = delete;
+        TimerWheel& operator=(const TimerWheel&) = delete;
+
+        // Pending timers are dropped without running.
+        ~TimerWheel() noexcept;
+
+        // Runs fn on the service thread no earlier than `deadline` (rounded up to the next tick).
+        template<Task F>
+        TimerId schedule_at(Clock::time_point deadline, F&& fn) noexcept {
+            return schedule_(deadline, UniqueTask{ std::forward<F>(fn) });
+        }
+
+        template<Task F>
+        TimerId schedule_after(Clock::duration delay, F&& fn) noexcept {
+            return schedule_(Clock::now() + delay, UniqueTask{ std::forward<F>(fn) });
+        }
+
+        // Returns true if the timer was pending and will not run.
+        bool cancel(TimerId id) noexcept;
+
+        usize size() const noexcept;
+
+    private:
+        TimerId schedule_(Clock::time_point deadline, UniqueTask fn) noexcept;
+
+        void link_(u32 index) noexcept;
+        void unlink_(u32 index) noexcept;
+        void release_(u32 index) noexcept;
+        void cascade_(usize level) noexcept;
+        void advance_(std::vector<UniqueTask>& fired) noexcept;
+        u64 next_event_() const noexcept;
+        void run_() noexcept;
+    };
+
+    TimerWheel& global_timer_wheel() noexcept;
+
+    /*
+    * A stop_token that is requested after a timeout, backed by a TimerWheel entry instead of a kernel timer.
+    * The entry is cancelled when the ScopedTimeout goes away.
+    */
+    class ScopedTimeout {
+    private:
+        TimerWheel& wheel_;
+        std::stop_source source_;
+        TimerWheel::TimerId id_;
+
+    public:
+        ScopedTimeout(TimerWheel::Clock::duration timeout, TimerWheel& wheel = global_timer_wheel()) noexcept
+            : wheel_{ wheel }
+            , id_{ wheel.schedule_after(timeout, [source = source_]() mutable { source.request_stop(); }) }
+        {}
+
+        ScopedTimeout(ScopedTimeout&&) noexcept = delete;
+        ScopedTimeout& operator=(ScopedTimeout&&) noexcept = delete;
+
+        ScopedTimeout(const ScopedTimeout&) = delete;
+        ScopedTimeout& operator=(const ScopedTimeout&) = delete;
+
+        ~ScopedTimeout() noexcept {
+            wheel_.cancel(id_);
+        }
+
+        std::stop_token token() const noexcept {
+            return source_.get_token();
+        }
+
+        bool expired() const noexcept {
+            return source_.stop_requested();
+        }
+    };
+
+    // Synced::lock_when with a timeout; std::nullopt if pred did not become true in time.
+    template<Send T, Mutex M, std::predicate<const T&> Pred>
+    [[nodiscard]]
+    std::optional<Locked<T, M>> lock_when_for(Synced<T, M>& synced, TimerWheel::Clock::duration timeout, Pred pred, TimerWheel& wheel = global_timer_wheel()) noexcept {
+        ScopedTimeout deadline{ timeout, wheel };
+        return synced.lock_when(deadline.token(), std::move(pred));
+    }
+
+    // Channel::pop with a timeout; std::nullopt on timeout or when the channel is closed and drained.
+    template<std::movable T, WaitStrategy Wait>
+    [[nodiscard]]
+    std::optional<T> pop_for(Channel<T, Wait>& channel, TimerWheel::Clock::duration timeout, TimerWheel& wheel = global_timer_wheel()) noexcept {
+        if (auto value = channel.try_pop()) {
+            return value;
+        }
+
+        ScopedTimeout deadline{ timeout, wheel };
+        return channel.pop(deadline.token());
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <concepts>
+#include <utility>
+
+#include <fuwa/types.hpp>
+
+#include "common.hpp"
+
+namespace agano {
+    /*
+    * TripleBuffer<T> hands the latest complete value from one producer thread to one consumer thread.
+    * The producer fills its private back slot and publishes it by swapping it with the shared middle slot;
+    * the consumer swaps the middle slot with its private front slot when a new value is there.
+    * Both sides are wait-free (one atomic exchange each), nothing is copied, and intermediate values
+    * the consumer did not get to are simply overwritten.
+    */
+    template<std::default_initializable T>
+    class TripleBuffer {
+    private:
+        // Low two bits: slot index, fresh_bit: the middle slot holds a value the consumer has not taken yet.
+        static constexpr u8 index_mask = 0b11u;
+        static constexpr u8 fresh_bit = 0b100u;
+
+        struct alignas(cache_line_size) Slot {
+            T value{};
+        };
+
+        Slot slots_[3];
+        alignas(cache_line_size) std::atomic<u8> middle_{ 1 };
+        alignas(cache_line_size) u8 back_ = 0;
+        alignas(cache_line_size) u8 front_ = 2;
+
+    public:
+        TripleBuffer() noexcept = default;
+
+        // Every slot starts as a copy of initial, so the consumer reads it until the first publish.
+        explicit TripleBuffer(const T& initial) noexcept requires std::copy_constructible<T>
+            : slots_{ Slot{ initial }, Slot{ initial }, Slot{ initial } }
+        {}
+
+        TripleBuffer(TripleBuffer&&) noexcept = delete;
+        TripleBuffer& operator=(TripleBuffer&&) noexcept = delete;
+
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+        ~TripleBuffer() noexcept = default;
+
+        // Producer: the slot to fill next. It holds an older value, so overwrite everything that matters.
+        T& write_buffer() noexcept {
+            return slots_[back_].value;
+        }
+
+        // Producer: makes the write buffer the newest value.
+        void publish() noexcept {
+            back_ = middle_.exchange(static_cast<u8>(back_ | fresh_bit), std::memory_order_acq_rel) & index_mask;
+        }
+
+        // Producer: write_buffer() = value, then publish().
+        void publish(T value) noexcept {
+            slots_[back_].value = std::move(value);
+            publish();
+        }
+
+        // Consumer: true if a value newer than the one read() last returned is available.
+        bool has_update() const noexcept {
+            return (middle_.load(std::memory_order_relaxed) & fresh_bit) != 0;
+        }
+
+        // Consumer: the newest published value. It stays valid and unchanged until the next read().
+        const T& read() noexcept {
+            if (has_update()) {
+                front_ = middle_.exchange(front_, std::memory_order_acq_rel) & index_mask;
+            }
+            return slots_[front_].value;
+        }
+
+        // Consumer: mutable access to the value read() returned last, e.g. to move out of it.
+        T& read_buffer() noexcept {
+            return slots_[front_].value;
+        }
+    };
+}
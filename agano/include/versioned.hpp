@@ -0,0 +1,239 @@
+#pragma once
+#include <atomic>
+#include <concepts>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <fuwa/types.hpp>
+#include <fuwa/assert.hpp>
+
+#include "agano.hpp"
+#include "common.hpp"
+
+namespace agano {
+    /*
+    * Versioned<T> is a multi-version container. Every commit appends a new immutable version stamped with
+    * the next value of a commit counter. A reader takes a Snapshot: it pins the current timestamp in one of
+    * a fixed number of reader slots and sees the newest version not newer than it, without taking any lock,
+    * for as long as it likes. Writers are serialized among themselves but never wait for readers; after
+    * each commit they free the versions no pinned timestamp can reach any more.
+    */
+    template<std::movable T>
+    class Versioned {
+    private:
+        struct Version {
+            u64 timestamp;
+            T value;
+            std::atomic<Version*> older;
+        };
+
+        struct alignas(cache_line_size) ReaderSlot {
+            std::atomic<u64> timestamp{ inactive };
+        };
+
+        static constexpr u64 inactive = std::numeric_limits<u64>::max();
+        // Claimed by a reader that has not pinned a timestamp yet; as large as inactive for the collector.
+        static constexpr u64 reserved = inactive - 1;
+
+        std::unique_ptr<ReaderSlot[]> slots_;
+        usize slot_count_;
+
+        alignas(cache_line_size) std::atomic<Version*> head_;
+        alignas(cache_line_size) std::atomic<u64> clock_{ 0 };
+        std::mutex writer_mutex_;
+
+    public:
+        class Snapshot {
+        private:
+            const Version* version_ = nullptr;
+            ReaderSlot* slot_ = nullptr;
+
+            friend class Versioned;
+
+            Snapshot(const Version* version, ReaderSlot* slot) noexcept
+                : version_{ version }
+                , slot_{ slot }
+            {}
+
+        public:
+            Snapshot(Snapshot&& rhs) noexcept
+                : version_{ std::exchange(rhs.version_, nullptr) }
+                , slot_{ std::exchange(rhs.slot_, nullptr) }
+            {}
+
+            Snapshot& operator=(Snapshot&& rhs) noexcept {
+                if (this != &rhs) {
+                    release_();
+                    version_ = std::exchange(rhs.version_, nullptr);
+                    slot_ = std::exchange(rhs.slot_, nullptr);
+                }
+                return *this;
+            }
+
+            Snapshot(const Snapshot&) = delete;
+            Snapshot& operator=(const Snapshot&) = delete;
+
+            ~Snapshot() noexcept {
+                release_();
+            }
+
+            const T* operator->() const noexcept {
+                EH_ASSERT(version_ != nullptr, "Access to a released snapshot");
+                return &version_->value;
+            }
+
+            const T& operator*() const noexcept {
+                EH_ASSERT(version_ != nullptr, "Access to a released snapshot");
+                return version_->value;
+            }
+
+            // Commit timestamp of the version this snapshot sees.
+            u64 timestamp() const noexcept {
+                return version_ != nullptr ? version_->timestamp : 0;
+            }
+
+        private:
+            void release_() noexcept {
+                if (slot_ != nullptr) {
+                    slot_->timestamp.store(inactive, std::memory_order_release);
+                }
+                version_ = nullptr;
+                slot_ = nullptr;
+            }
+        };
+
+        static constexpr usize default_max_snapshots = 64u;
+
+        // At most max_snapshots snapshots can be alive at once; taking one more waits for a free slot.
+        explicit Versioned(T initial, usize max_snapshots = default_max_snapshots) noexcept
+            : slots_{ std::make_unique<ReaderSlot[]>(std::max<usize>(max_snapshots, 1u)) }
+            , slot_count_{ std::max<usize>(max_snapshots, 1u) }
+            , head_{ new Version{ 0, std::move(initial), nullptr } }
+        {}
+
+        Versioned(Versioned&&) noexcept = delete;
+        Versioned& operator=(Versioned&&) noexcept = delete;
+
+        Versioned(const Versioned&) = delete;
+        Versioned& operator=(const Versioned&) = delete;
+
+        // Every snapshot must be released before.
+        ~Versioned() noexcept {
+            free_chain_(head_.load(std::memory_order_relaxed));
+        }
+
+        [[nodiscard]]
+        Snapshot snapshot() noexcept {
+            ReaderSlot& slot = acquire_slot_();
+
+            // Pin a timestamp that is still the latest after it became visible to writers. A writer that
+            // collected before seeing the slot has already moved the clock, so we retry; one that sees it
+            // keeps the version.
+            u64 timestamp = clock_.load(std::memory_order_seq_cst);
+            while (true) {
+                slot.timestamp.store(timestamp, std::memory_order_seq_cst);
+                const u64 current = clock_.load(std::memory_order_seq_cst);
+                if (current == timestamp) {
+                    break;
+                }
+                timestamp = current;
+            }
+
+            const Version* version = head_.load(std::memory_order_acquire);
+            while (version->timestamp > timestamp) {
+                version = version->older.load(std::memory_order_acquire);
+            }
+            return Snapshot{ version, &slot };
+        }
+
+        // Appends a new version and returns its commit timestamp.
+        u64 commit(T value) noexcept {
+            std::lock_guard lock{ writer_mutex_ };
+            return commit_locked_(std::move(value));
+        }
+
+        // Commits fn(latest), computed while holding the writer lock so concurrent updates are not lost.
+        template<typename Fn>
+            requires std::invocable<Fn&, const T&> && std::convertible_to<std::invoke_result_t<Fn&, const T&>, T>
+        u64 update(Fn&& fn) noexcept {
+            std::lock_guard lock{ writer_mutex_ };
+            const Version* latest = head_.load(std::memory_order_relaxed);
+            return commit_locked_(T{ fn(std::as_const(latest->value)) });
+        }
+
+        // Timestamp of the latest commit.
+        u64 timestamp() const noexcept {
+            return clock_.load(std::memory_order_acquire);
+        }
+
+        // Number of versions kept alive, including the latest.
+        usize version_count() noexcept {
+            std::lock_guard lock{ writer_mutex_ };
+            usize count = 0;
+            for (const Version* version = head_.load(std::memory_order_relaxed); version != nullptr; version = version->older.load(std::memory_order_relaxed)) {
+                ++count;
+            }
+            return count;
+        }
+
+        // Frees versions no snapshot can see. Commits do this already; call it after releasing long-lived snapshots.
+        void collect() noexcept {
+            std::lock_guard lock{ writer_mutex_ };
+            collect_locked_();
+        }
+
+    private:
+        ReaderSlot& acquire_slot_() noexcept {
+            const usize start = std::hash<std::thread::id>{}(std::this_thread::get_id()) % slot_count_;
+            while (true) {
+                for (usize i = 0; i < slot_count_; ++i) {
+                    ReaderSlot& slot = slots_[(start + i) % slot_count_];
+                    u64 expected = inactive;
+                    if (slot.timestamp.load(std::memory_order_relaxed) == inactive
+                        && slot.timestamp.compare_exchange_strong(expected, reserved, std::memory_order_relaxed)) {
+                        return slot;
+                    }
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        u64 commit_locked_(T&& value) noexcept {
+            const u64 timestamp = clock_.load(std::memory_order_relaxed) + 1;
+            auto* version = new Version{ timestamp, std::move(value), head_.load(std::memory_order_relaxed) };
+
+            // head_ goes first: a reader that sees the new clock must also find the version.
+            head_.store(version, std::memory_order_seq_cst);
+            clock_.store(timestamp, std::memory_order_seq_cst);
+
+            collect_locked_();
+            return timestamp;
+        }
+
+        void collect_locked_() noexcept {
+            u64 oldest = clock_.load(std::memory_order_relaxed);
+            for (usize i = 0; i < slot_count_; ++i) {
+                oldest = std::min(oldest, slots_[i].timestamp.load(std::memory_order_seq_cst));
+            }
+
+            // Keep the newest version visible at `oldest`; everything older is unreachable.
+            Version* keep = head_.load(std::memory_order_relaxed);
+            while (keep->timestamp > oldest) {
+                keep = keep->older.load(std::memory_order_relaxed);
+            }
+            free_chain_(keep->older.exchange(nullptr, std::memory_order_relaxed));
+        }
+
+        static void free_chain_(Version* version) noexcept {
+            while (version != nullptr) {
+                Version* older = version->older.load(std::memory_order_relaxed);
+                delete version;
+                version = older;
+            }
+        }
+    };
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include <atomic>
+#include <concepts>
+#include <thread>
+
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+#include <fuwa/types.hpp>
+
+#include "agano.hpp"
+
+namespace agano {
+    // Hint to the CPU that we are in a spin loop (pause on x86, yield on ARM).
+    inline void cpu_relax() noexcept {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield" ::: "memory");
+#endif
+    }
+
+    /*
+    * A wait strategy decides how a thread waits for an atomic word to change from `old`.
+    * wait() may return spuriously; callers re-check their condition in a loop.
+    * notify() is called by the thread that changed the word. Words are 32-bit (futex-sized epochs and locks)
+    * or 64-bit (sequence numbers).
+    */
+    template<typename W>
+    concept WaitStrategy = requires(const W strategy, std::atomic<u32>& word32, u32 old32, std::atomic<u64>& word64, u64 old64) {
+        strategy.wait(word32, old32);
+        strategy.notify(word32);
+        strategy.wait(word64, old64);
+        strategy.notify(word64);
+    };
+
+    struct BusySpinWait {
+        template<typename T>
+        void wait(const std::atomic<T>& word, T old) const noexcept {
+            while (word.load(std::memory_order_relaxed) == old) {
+                cpu_relax();
+            }
+        }
+
+        template<typename T>
+        void notify(std::atomic<T>&) const noexcept {}
+    };
+
+    struct YieldingWait {
+        template<typename T>
+        void wait(const std::atomic<T>& word, T old) const noexcept {
+            while (word.load(std::memory_order_relaxed) == old) {
+                std::this_thread::yield();
+            }
+        }
+
+        template<typename T>
+        void notify(std::atomic<T>&) const noexcept {}
+    };
+
+    // Spins for spin_budget iterations, then keeps yielding the time slice. Never sleeps in the kernel.
+    struct SpinThenYieldWait {
+        u32 spin_budget = default_spin_budget;
+
+        static constexpr u32 default_spin_budget = 4096u;
+
+        template<typename T>
+        void wait(const std::atomic<T>& word, T old) const noexcept {
+            for (u32 i = 0; i < spin_budget; ++i) {
+                if (word.load(std::memory_order_relaxed) != old) {
+                    return;
+                }
+                cpu_relax();
+            }
+
+            while (word.load(std::memory_order_relaxed) == old) {
+                std::this_thread::yield();
+            }
+        }
+
+        template<typename T>
+        void notify(std::atomic<T>&) const noexcept {}
+    };
+
+    // Spins for spin_budget iterations and only then parks in the kernel.
+    // Short waits avoid the futex wake-up latency, long ones stop burning the core.
+    struct SpinThenParkWait {
+        u32 spin_budget = default_spin_budget;
+
+        static constexpr u32 default_spin_budget = 4096u;
+
+        template<typename T>
+        void wait(const std::atomic<T>& word, T old) const noexcept {
+            for (u32 i = 0; i < spin_budget; ++i) {
+                if (word.load(std::memory_order_relaxed) != old) {
+                    return;
+                }
+                cpu_relax();
+            }
+            word.wait(old, std::memory_order_relaxed);
+        }
+
+        template<typename T>
+        void notify(std::atomic<T>& word) const noexcept {
+            word.notify_all();
+        }
+    };
+
+    // Sleeps in the kernel (futex on Linux) through std::atomic::wait.
+    struct BlockingWait {
+        template<typename T>
+        void wait(const std::atomic<T>& word, T old) const noexcept {
+            word.wait(old, std::memory_order_relaxed);
+        }
+
+        template<typename T>
+        void notify(std::atomic<T>& word) const noexcept {
+            word.notify_all();
+        }
+    };
+
+    /*
+    * WaitMutex satisfies agano::Mutex and waits for the lock with the given strategy, so a Synced can trade
+    * a dedicated core for lower hand-off latency. The word is 0 (unlocked), 1 (locked) or 2 (locked with
+    * waiters); unlock() only calls notify() when someone may be waiting.
+    */
+    template<WaitStrategy Wait = SpinThenParkWait>
+    class WaitMutex {
+    private:
+        static constexpr u32 unlocked = 0u;
+        static constexpr u32 locked = 1u;
+        static constexpr u32 contended = 2u;
+
+        // 32 bits, so that parking strategies wait on the word directly with a futex.
+        std::atomic<u32> state_{ unlocked };
+        [[no_unique_address]] Wait wait_;
+
+    public:
+        explicit WaitMutex(Wait wait = {}) noexcept
+            : wait_{ std::move(wait) }
+        {}
+
+        WaitMutex(WaitMutex&&) noexcept = delete;
+        WaitMutex& operator=(WaitMutex&&) noexcept = delete;
+
+        WaitMutex(const WaitMutex&) = delete;
+        WaitMutex& operator=(const WaitMutex&) = delete;
+
+        ~WaitMutex() noexcept = default;
+
+        bool try_lock() noexcept {
+            u32 expected = unlocked;
+            return state_.compare_exchange_strong(expected, locked, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        void lock() noexcept {
+            u32 state = unlocked;
+            if (state_.compare_exchange_strong(state, locked, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return;
+            }
+
+            if (state != contended) {
+                state = state_.exchange(contended, std::memory_order_acquire);
+            }
+            while (state != unlocked) {
+                wait_.wait(state_, contended);
+                state = state_.exchange(contended, std::memory_order_acquire);
+            }
+        }
+
+        void unlock() noexcept {
+            if (state_.exchange(unlocked, std::memory_order_release) == contended) {
+                wait_.notify(state_);
+            }
+        }
+    };
+
+    // Synced whose lock() waits with the given strategy instead of std::mutex.
+    // lock_when() sleeps in std::atomic::wait on the Synced's wake epoch.
+    template<Send T, WaitStrategy Wait = SpinThenParkWait>
+    using WaitSynced = Synced<T, WaitMutex<Wait>>;
+}
@@ -0,0 +1,469 @@
+#include "fiber.hpp"
+
+#if AGANO_HAS_FIBERS
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <fuwa/assert.hpp>
+
+#include "wait_strategy.hpp"
+
+// ASan tracks one stack per thread; every switch has to tell it which stack is about to run.
+#if defined(__SANITIZE_ADDRESS__)
+    #define AGANO_FIBER_ASAN 1
+#elif defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define AGANO_FIBER_ASAN 1
+    #endif
+#endif
+
+#if defined(AGANO_FIBER_ASAN)
+#include <sanitizer/asan_interface.h>
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+extern "C" {
+    // Saves callee-saved registers on the current stack, stores the stack pointer to *save_sp
+    // and resumes the context whose stack pointer is load_sp.
+    void agano_switch_context(void** save_sp, void* load_sp) noexcept;
+
+    // First frame of every fiber: calls entry(arg) with entry and arg taken from callee-saved registers.
+    void agano_fiber_trampoline() noexcept;
+}
+
+#if defined(__x86_64__)
+asm(R"(
+    .text
+    .globl agano_switch_context
+    .type agano_switch_context, @function
+    .align 16
+agano_switch_context:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size agano_switch_context, .-agano_switch_context
+
+    .globl agano_fiber_trampoline
+    .type agano_fiber_trampoline, @function
+    .align 16
+agano_fiber_trampoline:
+    movq %r12, %rdi
+    callq *%r13
+    ud2
+    .size agano_fiber_trampoline, .-agano_fiber_trampoline
+)");
+#elif defined(__aarch64__)
+asm(R"(
+    .text
+    .globl agano_switch_context
+    .type agano_switch_context, %function
+    .align 4
+agano_switch_context:
+    sub sp, sp, #176
+    stp x19, x20, [sp, #0]
+    stp x21, x22, [sp, #16]
+    stp x23, x24, [sp, #32]
+    stp x25, x26, [sp, #48]
+    stp x27, x28, [sp, #64]
+    stp x29, x30, [sp, #80]
+    stp d8, d9, [sp, #96]
+    stp d10, d11, [sp, #112]
+    stp d12, d13, [sp, #128]
+    stp d14, d15, [sp, #144]
+    mov x2, sp
+    str x2, [x0]
+    mov sp, x1
+    ldp x19, x20, [sp, #0]
+    ldp x21, x22, [sp, #16]
+    ldp x23, x24, [sp, #32]
+    ldp x25, x26, [sp, #48]
+    ldp x27, x28, [sp, #64]
+    ldp x29, x30, [sp, #80]
+    ldp d8, d9, [sp, #96]
+    ldp d10, d11, [sp, #112]
+    ldp d12, d13, [sp, #128]
+    ldp d14, d15, [sp, #144]
+    add sp, sp, #176
+    ret
+    .size agano_switch_context, .-agano_switch_context
+
+    .globl agano_fiber_trampoline
+    .type agano_fiber_trampoline, %function
+    .align 4
+agano_fiber_trampoline:
+    mov x0, x19
+    blr x20
+    brk #0
+    .size agano_fiber_trampoline, .-agano_fiber_trampoline
+)");
+#endif
+
+namespace agano {
+    namespace detail {
+        enum class AfterSwitch {
+            eNone = 0,
+            eRequeue,
+            eFinish,
+            ePark,
+        };
+
+        struct Fiber {
+            void* sp = nullptr;
+            FiberStack stack;
+            UniqueTask fn;
+            FiberScheduler* scheduler = nullptr;
+            Fiber* next = nullptr;
+            // ASan's fake stack of this fiber while it is switched out.
+            void* fake_stack = nullptr;
+        };
+
+        // What the worker thread has to do once the fiber it was running has switched back to it.
+        struct WorkerState {
+            void* sp = nullptr;
+            Fiber* current = nullptr;
+            AfterSwitch action = AfterSwitch::eNone;
+            std::atomic_flag* unlock = nullptr;
+            // The thread's own stack, learned from ASan when the first fiber starts on it.
+            const void* stack_bottom = nullptr;
+            usize stack_size = 0;
+        };
+
+        namespace {
+            thread_local WorkerState worker_state;
+
+            // A fiber may resume on another thread, so the compiler must never reuse a TLS address across a switch.
+            [[gnu::noinline]]
+            WorkerState& worker() noexcept {
+                auto* state = &worker_state;
+                asm volatile("" : "+r"(state));
+                return *state;
+            }
+
+            usize page_size() noexcept {
+                static const auto size = static_cast<usize>(sysconf(_SC_PAGESIZE));
+                return size;
+            }
+
+            // Called right before a switch; fake_stack is nullptr when the current context never resumes.
+            void start_switch(void** fake_stack, const void* bottom, usize size) noexcept {
+#if defined(AGANO_FIBER_ASAN)
+                __sanitizer_start_switch_fiber(fake_stack, bottom, size);
+#else
+                static_cast<void>(fake_stack);
+                static_cast<void>(bottom);
+                static_cast<void>(size);
+#endif
+            }
+
+            // Called first thing in the context that was switched to.
+            void finish_switch(void* fake_stack, const void** old_bottom, usize* old_size) noexcept {
+#if defined(AGANO_FIBER_ASAN)
+                __sanitizer_finish_switch_fiber(fake_stack, old_bottom, old_size);
+#else
+                static_cast<void>(fake_stack);
+                static_cast<void>(old_bottom);
+                static_cast<void>(old_size);
+#endif
+            }
+
+            // Switches from a fiber back to its worker thread. Returns once the fiber is resumed, possibly on another thread.
+            void switch_to_worker(Fiber* fiber, bool finished) noexcept {
+                WorkerState& state = worker();
+                start_switch(finished ? nullptr : &fiber->fake_stack, state.stack_bottom, state.stack_size);
+                agano_switch_context(&fiber->sp, state.sp);
+
+                WorkerState& resumed = worker();
+                finish_switch(fiber->fake_stack, &resumed.stack_bottom, &resumed.stack_size);
+            }
+
+            [[noreturn]]
+            void fiber_entry(void* arg) noexcept {
+                WorkerState& state = worker();
+                finish_switch(nullptr, &state.stack_bottom, &state.stack_size);
+
+                auto* fiber = static_cast<Fiber*>(arg);
+                fiber->fn();
+                fiber->fn = UniqueTask{};
+
+                worker().action = AfterSwitch::eFinish;
+                switch_to_worker(fiber, true);
+                EH_UNREACHABLE();
+            }
+
+            void* prepare_stack(const FiberStack& stack, Fiber* fiber) noexcept {
+                auto top = reinterpret_cast<uintptr_t>(stack.base) + stack.size;
+                top &= ~uintptr_t{ 15 };
+                auto* frame = reinterpret_cast<u64*>(top);
+
+#if defined(__x86_64__)
+                // Layout expected by agano_switch_context: fp control, r15, r14, r13, r12, rbx, rbp, return address.
+                frame -= 10;
+                frame[0] = 0x1F80u | (u64{ 0x037Fu } << 32u);
+                frame[1] = 0;
+                frame[2] = 0;
+                frame[3] = reinterpret_cast<u64>(&fiber_entry);
+                frame[4] = reinterpret_cast<u64>(fiber);
+                frame[5] = 0;
+                frame[6] = 0;
+                frame[7] = reinterpret_cast<u64>(&agano_fiber_trampoline);
+                frame[8] = 0;
+                frame[9] = 0;
+#elif defined(__aarch64__)
+                // x19..x28, x29, x30, d8..d15, padding.
+                frame -= 22;
+                std::fill(frame, frame + 22, u64{ 0 });
+                frame[0] = reinterpret_cast<u64>(fiber);
+                frame[1] = reinterpret_cast<u64>(&fiber_entry);
+                frame[11] = reinterpret_cast<u64>(&agano_fiber_trampoline);
+#endif
+                return frame;
+            }
+
+            void lock_guard_flag(std::atomic_flag& flag) noexcept {
+                while (flag.test_and_set(std::memory_order_acquire)) {
+                    cpu_relax();
+                }
+            }
+
+            // Suspends the current fiber; guard is released only after its context has been saved.
+            void park(std::atomic_flag& guard) noexcept {
+                WorkerState& state = worker();
+                Fiber* fiber = state.current;
+                state.action = AfterSwitch::ePark;
+                state.unlock = &guard;
+                switch_to_worker(fiber, false);
+            }
+        }
+
+        StackPool::StackPool(usize stack_size) noexcept
+            : stack_size_{ (stack_size + page_size() - 1) / page_size() * page_size() }
+        {}
+
+        StackPool::~StackPool() noexcept {
+            for (auto& stack : free_) {
+                munmap(stack.base, stack.size);
+            }
+        }
+
+        FiberStack StackPool::acquire() noexcept {
+            {
+                std::lock_guard lock{ mutex_ };
+                if (!free_.empty()) {
+                    FiberStack stack = free_.back();
+                    free_.pop_back();
+                    return stack;
+                }
+            }
+
+            const usize total = stack_size_ + page_size();
+            void* base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+            EH_ASSERT(base != MAP_FAILED, "Failed to allocate a fiber stack");
+            EH_ASSERT(mprotect(base, page_size(), PROT_NONE) == 0, "Failed to protect a fiber stack guard page");
+
+            return FiberStack{ base, total };
+        }
+
+        void StackPool::release(FiberStack stack) noexcept {
+#if defined(AGANO_FIBER_ASAN)
+            // Frames that never returned (fiber_entry at least) leave their redzones behind, and ASan keeps them
+            // even across munmap; the next fiber on this memory would trip over them.
+            __asan_unpoison_memory_region(static_cast<u8*>(stack.base) + page_size(), stack.size - page_size());
+#endif
+            {
+                std::lock_guard lock{ mutex_ };
+                if (free_.size() < max_cached) {
+                    free_.push_back(stack);
+                    return;
+                }
+            }
+            munmap(stack.base, stack.size);
+        }
+    }
+
+    FiberScheduler::FiberScheduler(usize thread_count, usize stack_size) noexcept
+        : stacks_{ stack_size }
+    {
+        workers_.reserve(thread_count);
+        for (usize i = 0; i < std::max<usize>(thread_count, 1u); ++i) {
+            workers_.emplace_back([this] { worker_loop_(); });
+        }
+    }
+
+    FiberScheduler::~FiberScheduler() noexcept {
+        wait_idle();
+        {
+            std::lock_guard lock{ mutex_ };
+            stopping_ = true;
+        }
+        cv_.notify_all();
+
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void FiberScheduler::wait_idle() noexcept {
+        std::unique_lock lock{ mutex_ };
+        idle_cv_.wait(lock, [this] { return live_ == 0; });
+    }
+
+    void FiberScheduler::spawn_(UniqueTask fn) noexcept {
+        auto* fiber = new detail::Fiber{};
+        fiber->fn = std::move(fn);
+        fiber->scheduler = this;
+        fiber->stack = stacks_.acquire();
+        fiber->sp = detail::prepare_stack(fiber->stack, fiber);
+
+        {
+            std::lock_guard lock{ mutex_ };
+            ++live_;
+            ready_.push_back(fiber);
+        }
+        cv_.notify_one();
+    }
+
+    void FiberScheduler::schedule_(detail::Fiber* fiber) noexcept {
+        {
+            std::lock_guard lock{ mutex_ };
+            ready_.push_back(fiber);
+        }
+        cv_.notify_one();
+    }
+
+    void FiberScheduler::worker_loop_() noexcept {
+        while (true) {
+            detail::Fiber* fiber = nullptr;
+            {
+                std::unique_lock lock{ mutex_ };
+                cv_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+                if (ready_.empty()) {
+                    return;
+                }
+
+                fiber = ready_.front();
+                ready_.pop_front();
+            }
+
+            detail::WorkerState& state = detail::worker();
+            state.current = fiber;
+            state.action = detail::AfterSwitch::eNone;
+
+            void* fake_stack = nullptr;
+            const auto* usable = static_cast<const u8*>(fiber->stack.base) + detail::page_size();
+            detail::start_switch(&fake_stack, usable, fiber->stack.size - detail::page_size());
+            agano_switch_context(&state.sp, fiber->sp);
+            detail::finish_switch(fake_stack, nullptr, nullptr);
+
+            switch (state.action) {
+            case detail::AfterSwitch::eRequeue:
+                schedule_(fiber);
+                break;
+            case detail::AfterSwitch::ePark:
+                state.unlock->clear(std::memory_order_release);
+                break;
+            case detail::AfterSwitch::eFinish:
+                stacks_.release(fiber->stack);
+                delete fiber;
+                {
+                    std::lock_guard lock{ mutex_ };
+                    if (--live_ == 0) {
+                        idle_cv_.notify_all();
+                    }
+                }
+                break;
+            case detail::AfterSwitch::eNone:
+                break;
+            }
+
+            state.current = nullptr;
+            state.action = detail::AfterSwitch::eNone;
+        }
+    }
+
+    namespace this_fiber {
+        bool is_fiber() noexcept {
+            return detail::worker().current != nullptr;
+        }
+
+        void yield() noexcept {
+            detail::WorkerState& state = detail::worker();
+            if (state.current == nullptr) {
+                std::this_thread::yield();
+                return;
+            }
+
+            state.action = detail::AfterSwitch::eRequeue;
+            detail::switch_to_worker(state.current, false);
+        }
+    }
+
+    void FiberMutex::lock() noexcept {
+        if (try_lock()) {
+            return;
+        }
+
+        if (!this_fiber::is_fiber()) {
+            while (!try_lock()) {
+                std::this_thread::yield();
+            }
+            return;
+        }
+
+        detail::lock_guard_flag(guard_);
+        if (try_lock()) {
+            guard_.clear(std::memory_order_release);
+            return;
+        }
+
+        detail::Fiber* fiber = detail::worker().current;
+        fiber->next = nullptr;
+        if (tail_ != nullptr) {
+            tail_->next = fiber;
+        }
+        else {
+            head_ = fiber;
+        }
+        tail_ = fiber;
+
+        // unlock() transfers ownership to us before rescheduling this fiber.
+        detail::park(guard_);
+    }
+
+    void FiberMutex::unlock() noexcept {
+        detail::lock_guard_flag(guard_);
+
+        detail::Fiber* fiber = head_;
+        if (fiber == nullptr) {
+            locked_.store(false, std::memory_order_release);
+            guard_.clear(std::memory_order_release);
+            return;
+        }
+
+        head_ = fiber->next;
+        if (head_ == nullptr) {
+            tail_ = nullptr;
+        }
+        guard_.clear(std::memory_order_release);
+
+        fiber->scheduler->schedule_(fiber);
+    }
+}
+#endif
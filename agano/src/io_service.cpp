@@ -0,0 +1,437 @@
+#include "io_service.hpp"
+
+#if AGANO_HAS_IO_SERVICE
+#include <atomic>
+#include <cerrno>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+    #include <linux/io_uring.h>
+    #include <sys/eventfd.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+#endif
+
+#include "thread_pool.hpp"
+
+namespace agano {
+    class IoService::Backend {
+    public:
+        virtual ~Backend() noexcept = default;
+
+        virtual void submit(detail::IoOp* op) noexcept = 0;
+        virtual bool is_io_uring() const noexcept = 0;
+    };
+
+    namespace {
+        i32 perform_blocking(const detail::IoOp& op) noexcept {
+            ssize_t result = 0;
+            switch (op.opcode) {
+            case detail::IoOpcode::eRead:
+                result = pread(op.fd, op.buffer, op.length, static_cast<off_t>(op.offset));
+                break;
+            case detail::IoOpcode::eWrite:
+                result = pwrite(op.fd, op.buffer, op.length, static_cast<off_t>(op.offset));
+                break;
+            case detail::IoOpcode::eFsync:
+                result = ::fsync(op.fd);
+                break;
+            case detail::IoOpcode::eOpen:
+                result = ::open(op.path.c_str(), op.flags, op.mode);
+                break;
+            }
+            return result < 0 ? -errno : static_cast<i32>(result);
+        }
+
+        class PoolBackend final : public IoService::Backend {
+        private:
+            ThreadPool pool_;
+
+        public:
+            explicit PoolBackend(usize threads) noexcept
+                : pool_{ threads }
+            {}
+
+            // ThreadPool's destructor drains the queue, which completes every pending request.
+            ~PoolBackend() noexcept override = default;
+
+            void submit(detail::IoOp* op) noexcept override {
+                pool_.submit([op] { op->complete(op, perform_blocking(*op)); });
+            }
+
+            bool is_io_uring() const noexcept override {
+                return false;
+            }
+        };
+
+#if defined(__linux__)
+        class UringBackend final : public IoService::Backend {
+        private:
+            // user_data of the read that keeps the eventfd armed; requests use their IoOp address.
+            static constexpr u64 wakeup_tag = 0;
+
+            i32 ring_fd_ = -1;
+            i32 event_fd_ = -1;
+            u64 event_value_ = 0;
+
+            void* sq_ptr_ = nullptr;
+            usize sq_size_ = 0;
+            void* cq_ptr_ = nullptr;
+            usize cq_size_ = 0;
+            io_uring_sqe* sqes_ = nullptr;
+            usize sqes_size_ = 0;
+
+            u32* sq_head_ = nullptr;
+            u32* sq_tail_ = nullptr;
+            u32* sq_array_ = nullptr;
+            u32 sq_mask_ = 0;
+            u32 sq_entries_ = 0;
+
+            u32* cq_head_ = nullptr;
+            u32* cq_tail_ = nullptr;
+            io_uring_cqe* cqes_ = nullptr;
+            u32 cq_mask_ = 0;
+            u32 cq_entries_ = 0;
+
+            std::mutex mutex_;
+            std::vector<detail::IoOp*> pending_;
+            bool stopping_ = false;
+
+            std::thread thread_;
+
+        public:
+            UringBackend() noexcept = default;
+
+            ~UringBackend() noexcept override {
+                if (thread_.joinable()) {
+                    {
+                        std::lock_guard lock{ mutex_ };
+                        stopping_ = true;
+                    }
+                    wake_();
+                    thread_.join();
+                }
+
+                if (sqes_ != nullptr) {
+                    munmap(sqes_, sqes_size_);
+                }
+                if (cq_ptr_ != nullptr && cq_ptr_ != sq_ptr_) {
+                    munmap(cq_ptr_, cq_size_);
+                }
+                if (sq_ptr_ != nullptr) {
+                    munmap(sq_ptr_, sq_size_);
+                }
+                if (event_fd_ >= 0) {
+                    close(event_fd_);
+                }
+                if (ring_fd_ >= 0) {
+                    close(ring_fd_);
+                }
+            }
+
+            // Returns false if io_uring cannot be used here; the object must then be discarded.
+            bool init(u32 entries) noexcept {
+                io_uring_params params{};
+                ring_fd_ = static_cast<i32>(syscall(__NR_io_uring_setup, entries, &params));
+                if (ring_fd_ < 0 || !supports_ops_()) {
+                    return false;
+                }
+
+                sq_size_ = params.sq_off.array + params.sq_entries * sizeof(u32);
+                cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (single_mmap) {
+                    sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+                }
+
+                sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+                if (sq_ptr_ == MAP_FAILED) {
+                    sq_ptr_ = nullptr;
+                    return false;
+                }
+
+                cq_ptr_ = single_mmap ? sq_ptr_ : mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+                if (cq_ptr_ == MAP_FAILED) {
+                    cq_ptr_ = nullptr;
+                    return false;
+                }
+
+                sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+                void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+                if (sqes == MAP_FAILED) {
+                    return false;
+                }
+                sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+                auto* sq = static_cast<std::byte*>(sq_ptr_);
+                sq_head_ = reinterpret_cast<u32*>(sq + params.sq_off.head);
+                sq_tail_ = reinterpret_cast<u32*>(sq + params.sq_off.tail);
+                sq_array_ = reinterpret_cast<u32*>(sq + params.sq_off.array);
+                sq_mask_ = *reinterpret_cast<u32*>(sq + params.sq_off.ring_mask);
+                sq_entries_ = params.sq_entries;
+
+                auto* cq = static_cast<std::byte*>(cq_ptr_);
+                cq_head_ = reinterpret_cast<u32*>(cq + params.cq_off.head);
+                cq_tail_ = reinterpret_cast<u32*>(cq + params.cq_off.tail);
+                cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+                cq_mask_ = *reinterpret_cast<u32*>(cq + params.cq_off.ring_mask);
+                cq_entries_ = params.cq_entries;
+
+                event_fd_ = eventfd(0, EFD_CLOEXEC);
+                if (event_fd_ < 0) {
+                    return false;
+                }
+
+                thread_ = std::thread{ [this] { run_(); } };
+                return true;
+            }
+
+            void submit(detail::IoOp* op) noexcept override {
+                bool was_empty = false;
+                {
+                    std::lock_guard lock{ mutex_ };
+                    was_empty = pending_.empty();
+                    pending_.push_back(op);
+                }
+
+                // Requests queued behind a non-empty batch are picked up with it.
+                if (was_empty) {
+                    wake_();
+                }
+            }
+
+            bool is_io_uring() const noexcept override {
+                return true;
+            }
+
+        private:
+            bool supports_ops_() noexcept {
+                constexpr usize op_count = IORING_OP_LAST;
+                alignas(io_uring_probe) std::byte storage[sizeof(io_uring_probe) + op_count * sizeof(io_uring_probe_op)]{};
+                auto* probe = reinterpret_cast<io_uring_probe*>(storage);
+
+                if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PROBE, probe, op_count) < 0) {
+                    return false;
+                }
+
+                for (u8 op : { IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC, IORING_OP_OPENAT }) {
+                    if (op > probe->last_op || (probe->ops[op].flags & IO_URING_OP_SUPPORTED) == 0) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            void wake_() noexcept {
+                const u64 one = 1;
+                static_cast<void>(::write(event_fd_, &one, sizeof(one)));
+            }
+
+            io_uring_sqe* next_sqe_() noexcept {
+                const u32 tail = *sq_tail_;
+                const u32 head = std::atomic_ref<u32>{ *sq_head_ }.load(std::memory_order_acquire);
+                if (tail - head == sq_entries_) {
+                    return nullptr;
+                }
+
+                const u32 index = tail & sq_mask_;
+                io_uring_sqe* sqe = &sqes_[index];
+                std::memset(sqe, 0, sizeof(*sqe));
+                sq_array_[index] = index;
+                return sqe;
+            }
+
+            void commit_sqe_() noexcept {
+                std::atomic_ref<u32>{ *sq_tail_ }.store(*sq_tail_ + 1, std::memory_order_release);
+            }
+
+            // Queues the eventfd read that lets other threads interrupt io_uring_enter. False if the SQ is full.
+            bool arm_wakeup_() noexcept {
+                io_uring_sqe* sqe = next_sqe_();
+                if (sqe == nullptr) {
+                    return false;
+                }
+
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = event_fd_;
+                sqe->addr = reinterpret_cast<u64>(&event_value_);
+                sqe->len = sizeof(event_value_);
+                sqe->user_data = wakeup_tag;
+                commit_sqe_();
+                return true;
+            }
+
+            void prepare_(io_uring_sqe* sqe, detail::IoOp* op) noexcept {
+                sqe->fd = op->fd;
+                sqe->user_data = reinterpret_cast<u64>(op);
+
+                switch (op->opcode) {
+                case detail::IoOpcode::eRead:
+                    sqe->opcode = IORING_OP_READ;
+                    sqe->addr = reinterpret_cast<u64>(op->buffer);
+                    sqe->len = op->length;
+                    sqe->off = op->offset;
+                    break;
+                case detail::IoOpcode::eWrite:
+                    sqe->opcode = IORING_OP_WRITE;
+                    sqe->addr = reinterpret_cast<u64>(op->buffer);
+                    sqe->len = op->length;
+                    sqe->off = op->offset;
+                    break;
+                case detail::IoOpcode::eFsync:
+                    sqe->opcode = IORING_OP_FSYNC;
+                    break;
+                case detail::IoOpcode::eOpen:
+                    sqe->opcode = IORING_OP_OPENAT;
+                    sqe->fd = AT_FDCWD;
+                    sqe->addr = reinterpret_cast<u64>(op->path.c_str());
+                    sqe->len = op->mode;
+                    sqe->open_flags = static_cast<u32>(op->flags);
+                    break;
+                }
+            }
+
+            void run_() noexcept {
+                std::vector<detail::IoOp*> backlog;
+                std::vector<detail::IoOp*> incoming;
+                u32 in_flight = 0;
+                bool stopping = false;
+
+                bool wakeup_armed = arm_wakeup_();
+                u32 to_submit = wakeup_armed ? 1u : 0u;
+
+                while (true) {
+                    {
+                        std::lock_guard lock{ mutex_ };
+                        incoming.swap(pending_);
+                        stopping = stopping_;
+                    }
+                    backlog.insert(backlog.end(), incoming.begin(), incoming.end());
+                    incoming.clear();
+
+                    // The wakeup read could not be queued when its completion arrived; it goes before any request.
+                    if (!wakeup_armed && arm_wakeup_()) {
+                        wakeup_armed = true;
+                        ++to_submit;
+                    }
+
+                    // One slot of the completion ring always belongs to the eventfd read.
+                    usize taken = 0;
+                    for (; taken < backlog.size() && in_flight + 1 < cq_entries_; ++taken) {
+                        io_uring_sqe* sqe = next_sqe_();
+                        if (sqe == nullptr) {
+                            break;
+                        }
+                        prepare_(sqe, backlog[taken]);
+                        commit_sqe_();
+                        ++in_flight;
+                        ++to_submit;
+                    }
+                    backlog.erase(backlog.begin(), backlog.begin() + static_cast<isize>(taken));
+
+                    if (stopping && in_flight == 0 && backlog.empty()) {
+                        return;
+                    }
+
+                    // Without an armed wakeup nothing could interrupt a blocking enter, so only submit and loop.
+                    const u32 min_complete = wakeup_armed ? 1u : 0u;
+                    const u32 enter_flags = wakeup_armed ? IORING_ENTER_GETEVENTS : 0u;
+                    const auto entered = syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, enter_flags, nullptr, 0);
+                    if (entered >= 0) {
+                        to_submit -= static_cast<u32>(entered);
+                    }
+                    else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                        fail_all_(backlog, -errno);
+                    }
+
+                    u32 head = *cq_head_;
+                    while (head != std::atomic_ref<u32>{ *cq_tail_ }.load(std::memory_order_acquire)) {
+                        const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                        if (cqe.user_data == wakeup_tag) {
+                            wakeup_armed = arm_wakeup_();
+                            to_submit += wakeup_armed ? 1u : 0u;
+                        }
+                        else {
+                            auto* op = reinterpret_cast<detail::IoOp*>(cqe.user_data);
+                            op->complete(op, cqe.res);
+                            --in_flight;
+                        }
+                        ++head;
+                    }
+                    std::atomic_ref<u32>{ *cq_head_ }.store(head, std::memory_order_release);
+                }
+            }
+
+            static void fail_all_(std::vector<detail::IoOp*>& ops, i32 error) noexcept {
+                for (auto* op : ops) {
+                    op->complete(op, error);
+                }
+                ops.clear();
+            }
+        };
+#endif
+
+        struct FutureOp : detail::IoOp {
+            std::promise<IoResult> promise;
+        };
+    }
+
+    IoService::IoService(usize queue_depth, IoBackend backend) noexcept {
+#if defined(__linux__)
+        if (backend != IoBackend::eThreadPool) {
+            auto uring = std::make_unique<UringBackend>();
+            if (uring->init(static_cast<u32>(queue_depth))) {
+                backend_ = std::move(uring);
+                return;
+            }
+        }
+#endif
+        static_cast<void>(backend);
+        backend_ = std::make_unique<PoolBackend>(std::clamp<usize>(queue_depth / 16, 2u, 64u));
+    }
+
+    IoService::~IoService() noexcept = default;
+
+    bool IoService::uses_io_uring() const noexcept {
+        return backend_->is_io_uring();
+    }
+
+    std::future<IoResult> IoService::read(i32 fd, std::span<std::byte> buffer, u64 offset) noexcept {
+        return submit_future_(make_rw_(detail::IoOpcode::eRead, fd, buffer.data(), buffer.size(), offset));
+    }
+
+    std::future<IoResult> IoService::write(i32 fd, std::span<const std::byte> buffer, u64 offset) noexcept {
+        return submit_future_(make_rw_(detail::IoOpcode::eWrite, fd, const_cast<std::byte*>(buffer.data()), buffer.size(), offset));
+    }
+
+    std::future<IoResult> IoService::fsync(i32 fd) noexcept {
+        return submit_future_(detail::IoOp{ .opcode = detail::IoOpcode::eFsync, .fd = fd });
+    }
+
+    std::future<IoResult> IoService::open(std::string_view path, i32 flags, u32 mode) noexcept {
+        return submit_future_(make_open_(path, flags, mode));
+    }
+
+    std::future<IoResult> IoService::submit_future_(detail::IoOp op) noexcept {
+        auto* request = new FutureOp{ std::move(op), {} };
+        request->complete = [](detail::IoOp* base, i32 result) noexcept {
+            auto* self = static_cast<FutureOp*>(base);
+            self->promise.set_value(detail::to_io_result(result));
+            delete self;
+        };
+
+        auto future = request->promise.get_future();
+        submit_(request);
+        return future;
+    }
+
+    void IoService::submit_(detail::IoOp* op) noexcept {
+        backend_->submit(op);
+    }
+}
+#endif
@@ -0,0 +1,245 @@
+#include "priority_pool.hpp"
+
+#include <limits>
+
+#include <fuwa/assert.hpp>
+
+namespace agano {
+    namespace {
+        thread_local const PriorityPool* current_priority_pool = nullptr;
+        thread_local usize current_worker = 0;
+
+        i64 now_ns() noexcept {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(PriorityPool::Clock::now().time_since_epoch()).count();
+        }
+    }
+
+    PriorityPool::PriorityPool(PriorityPoolOptions options) noexcept
+        : options_{ std::move(options) }
+    {
+        options_.thread_count = std::max<usize>(options_.thread_count, 1u);
+        EH_ASSERT(options_.class_count > 0, "Priority pool needs at least one class");
+        EH_ASSERT(options_.class_count == 1 || options_.reserved_workers < options_.thread_count, "At least one worker must serve the lower classes");
+
+        if (options_.weights.empty()) {
+            for (usize i = 0; i < options_.class_count; ++i) {
+                options_.weights.push_back(u32{ 1 } << std::min<usize>(options_.class_count - 1 - i, 31u));
+            }
+        }
+        EH_ASSERT(options_.weights.size() == options_.class_count, "Weights must have one entry per class");
+        for (auto& weight : options_.weights) {
+            weight = std::max(weight, 1u);
+        }
+
+        classes_ = std::make_unique<ClassState[]>(options_.class_count);
+        for (usize i = 0; i < options_.class_count; ++i) {
+            classes_[i].last_served.store(now_ns(), std::memory_order_relaxed);
+        }
+
+        // Workers steal from each other, so every queue must exist before the first thread starts.
+        workers_.reserve(options_.thread_count);
+        for (usize i = 0; i < options_.thread_count; ++i) {
+            auto worker = std::make_unique<Worker>();
+            worker->queues.resize(options_.class_count);
+            worker->current_weight.resize(options_.class_count, 0);
+            workers_.push_back(std::move(worker));
+        }
+
+        threads_.reserve(options_.thread_count);
+        for (usize i = 0; i < options_.thread_count; ++i) {
+            threads_.emplace_back([this, i] { worker_loop_(i); });
+        }
+    }
+
+    PriorityPool::~PriorityPool() noexcept {
+        {
+            std::lock_guard lock{ sleep_mutex_ };
+            stopping_ = true;
+        }
+        general_cv_.notify_all();
+        reserved_cv_.notify_all();
+
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    std::vector<PriorityClassStats> PriorityPool::stats() const noexcept {
+        std::vector<PriorityClassStats> result;
+        result.reserve(options_.class_count);
+
+        for (usize i = 0; i < options_.class_count; ++i) {
+            const ClassState& state = classes_[i];
+            const u64 executed = state.executed.load(std::memory_order_relaxed);
+            const u64 total = state.total_queue_ns.load(std::memory_order_relaxed);
+
+            result.push_back(PriorityClassStats{
+                .queued = state.pending.load(std::memory_order_relaxed),
+                .executed = executed,
+                .mean_queue_time = std::chrono::nanoseconds{ executed != 0 ? static_cast<i64>(total / executed) : 0 },
+                .max_queue_time = std::chrono::nanoseconds{ static_cast<i64>(state.max_queue_ns.load(std::memory_order_relaxed)) },
+            });
+        }
+        return result;
+    }
+
+    void PriorityPool::push_(usize priority_class, UniqueTask fn) noexcept {
+        EH_ASSERT(priority_class < options_.class_count, "Unknown priority class");
+
+        const usize index = current_priority_pool == this ? current_worker : next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+        ClassState& state = classes_[priority_class];
+        {
+            // pending is changed together with the queue, so it never counts an item that is not there.
+            Worker& worker = *workers_[index];
+            std::lock_guard lock{ worker.mutex };
+            worker.queues[priority_class].push_back(Item{ std::move(fn), Clock::now() });
+
+            // Time spent with nothing queued is not starvation.
+            if (state.pending.fetch_add(1, std::memory_order_relaxed) == 0) {
+                state.last_served.store(now_ns(), std::memory_order_relaxed);
+            }
+        }
+
+        // Pairs with the fence in worker_loop_: either the worker sees pending, or we see it counted as a sleeper.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool wake_reserved = priority_class == 0 && reserved_sleepers_.load(std::memory_order_relaxed) != 0;
+        const bool wake_general = general_sleepers_.load(std::memory_order_relaxed) != 0;
+        if (!wake_reserved && !wake_general) {
+            return;
+        }
+
+        // A counted sleeper holds sleep_mutex_ until it is inside wait(), so passing through it rules out a lost wake-up.
+        { std::lock_guard lock{ sleep_mutex_ }; }
+        if (wake_reserved) {
+            reserved_cv_.notify_one();
+        }
+        if (wake_general) {
+            general_cv_.notify_one();
+        }
+    }
+
+    bool PriorityPool::has_work_(bool reserved) const noexcept {
+        const usize classes = reserved ? 1u : options_.class_count;
+        for (usize i = 0; i < classes; ++i) {
+            if (classes_[i].pending.load(std::memory_order_relaxed) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    usize PriorityPool::pick_class_(Worker& worker, bool reserved) noexcept {
+        const usize none = options_.class_count;
+        if (reserved) {
+            return classes_[0].pending.load(std::memory_order_relaxed) != 0 ? 0 : none;
+        }
+
+        const i64 threshold = std::chrono::duration_cast<std::chrono::nanoseconds>(options_.starvation_threshold).count();
+        if (threshold > 0) {
+            const i64 now = now_ns();
+            usize starving = none;
+            i64 oldest = std::numeric_limits<i64>::max();
+            for (usize i = 0; i < options_.class_count; ++i) {
+                const ClassState& state = classes_[i];
+                const i64 served = state.last_served.load(std::memory_order_relaxed);
+                if (state.pending.load(std::memory_order_relaxed) != 0 && now - served >= threshold && served < oldest) {
+                    starving = i;
+                    oldest = served;
+                }
+            }
+
+            if (starving != none) {
+                return starving;
+            }
+        }
+
+        if (options_.policy == DrainPolicy::eStrict) {
+            for (usize i = 0; i < options_.class_count; ++i) {
+                if (classes_[i].pending.load(std::memory_order_relaxed) != 0) {
+                    return i;
+                }
+            }
+            return none;
+        }
+
+        // Smooth weighted round-robin over the classes that have work.
+        usize best = none;
+        i64 total = 0;
+        for (usize i = 0; i < options_.class_count; ++i) {
+            if (classes_[i].pending.load(std::memory_order_relaxed) == 0) {
+                continue;
+            }
+
+            worker.current_weight[i] += options_.weights[i];
+            total += options_.weights[i];
+            if (best == none || worker.current_weight[i] > worker.current_weight[best]) {
+                best = i;
+            }
+        }
+
+        if (best != none) {
+            worker.current_weight[best] -= total;
+        }
+        return best;
+    }
+
+    bool PriorityPool::take_(usize index, usize priority_class, Item& item) noexcept {
+        for (usize i = 0; i < workers_.size(); ++i) {
+            Worker& worker = *workers_[(index + i) % workers_.size()];
+            std::lock_guard lock{ worker.mutex };
+
+            auto& queue = worker.queues[priority_class];
+            if (!queue.empty()) {
+                item = std::move(queue.front());
+                queue.pop_front();
+                classes_[priority_class].pending.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void PriorityPool::record_(usize priority_class, Clock::time_point enqueued) noexcept {
+        const auto now = Clock::now();
+        const auto waited = static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - enqueued).count());
+
+        ClassState& state = classes_[priority_class];
+        state.last_served.store(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count(), std::memory_order_relaxed);
+        state.executed.fetch_add(1, std::memory_order_relaxed);
+        state.total_queue_ns.fetch_add(waited, std::memory_order_relaxed);
+
+        u64 max = state.max_queue_ns.load(std::memory_order_relaxed);
+        while (waited > max && !state.max_queue_ns.compare_exchange_weak(max, waited, std::memory_order_relaxed)) {}
+    }
+
+    void PriorityPool::worker_loop_(usize index) noexcept {
+        current_priority_pool = this;
+        current_worker = index;
+
+        const bool reserved = index < options_.reserved_workers;
+        Worker& worker = *workers_[index];
+        std::condition_variable& cv = reserved ? reserved_cv_ : general_cv_;
+        std::atomic<usize>& sleepers = reserved ? reserved_sleepers_ : general_sleepers_;
+
+        while (true) {
+            const usize priority_class = pick_class_(worker, reserved);
+            if (priority_class != options_.class_count) {
+                Item item;
+                if (take_(index, priority_class, item)) {
+                    record_(priority_class, item.enqueued);
+                    item.fn();
+                }
+                continue;
+            }
+
+            std::unique_lock lock{ sleep_mutex_ };
+            sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            cv.wait(lock, [&] { return stopping_ || has_work_(reserved); });
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            if (!has_work_(reserved)) {
+                return;
+            }
+        }
+    }
+}
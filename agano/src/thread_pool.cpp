@@ -0,0 +1,80 @@
+#include "thread_pool.hpp"
+
+namespace agano {
+    namespace {
+        thread_local const ThreadPool* current_pool = nullptr;
+    }
+
+    ThreadPool::ThreadPool(usize thread_count) noexcept {
+        workers_.reserve(thread_count);
+        for (usize i = 0; i < thread_count; ++i) {
+            workers_.emplace_back([this] { worker_loop_(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() noexcept {
+        {
+            std::lock_guard lock{ mutex_ };
+            stopping_ = true;
+        }
+        cv_.notify_all();
+
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    bool ThreadPool::try_run_one() noexcept {
+        UniqueTask task;
+        {
+            std::lock_guard lock{ mutex_ };
+            if (tasks_.empty()) {
+                return false;
+            }
+
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        task();
+        return true;
+    }
+
+    bool ThreadPool::owns_current_thread() const noexcept {
+        return current_pool == this;
+    }
+
+    void ThreadPool::push_(UniqueTask task) noexcept {
+        {
+            std::lock_guard lock{ mutex_ };
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    void ThreadPool::worker_loop_() noexcept {
+        current_pool = this;
+
+        while (true) {
+            UniqueTask task;
+            {
+                std::unique_lock lock{ mutex_ };
+                cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+
+                if (tasks_.empty()) {
+                    return;
+                }
+
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+
+            task();
+        }
+    }
+
+    ThreadPool& global_pool() noexcept {
+        static ThreadPool pool{};
+        return pool;
+    }
+}
@@ -0,0 +1,262 @@
+#include "timer_wheel.hpp"
+
+#include <fuwa/assert.hpp>
+
+namespace agano {
+    namespace {
+        constexpr u64 level_span(usize level, usize bits) noexcept {
+            return u64{ 1 } << (bits * (level + 1));
+        }
+    }
+
+    TimerWheel::TimerWheel(Clock::duration tick) noexcept
+        : tick_{ tick }
+        , epoch_{ Clock::now() }
+    {
+        EH_ASSERT(tick_ > Clock::duration::zero(), "Timer wheel tick must be positive");
+        buckets_.fill(npos);
+        thread_ = std::thread{ [this] { run_(); } };
+    }
+
+    TimerWheel::~TimerWheel() noexcept {
+        {
+            std::lock_guard lock{ mutex_ };
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    TimerWheel::TimerId TimerWheel::schedule_(Clock::time_point deadline, UniqueTask fn) noexcept {
+        // Round up so that a timer never fires early.
+        const auto since_epoch = std::max(deadline - epoch_, Clock::duration::zero());
+        const u64 expires = static_cast<u64>((since_epoch + tick_ - Clock::duration{ 1 }) / tick_);
+
+        bool wake = false;
+        TimerId id = invalid_timer;
+        {
+            std::lock_guard lock{ mutex_ };
+            // While idle the service thread does not advance current_; catch up so the timer lands in the right slot.
+            if (active_ == 0) {
+                current_ = std::max(current_, static_cast<u64>((Clock::now() - epoch_) / tick_));
+            }
+
+            u32 index = 0;
+            if (free_head_ != npos) {
+                index = free_head_;
+                free_head_ = nodes_[index].next;
+            }
+            else {
+                EH_ASSERT(nodes_.size() < npos, "Too many timers");
+                index = static_cast<u32>(nodes_.size());
+                nodes_.emplace_back();
+            }
+
+            Node& node = nodes_[index];
+            node.expires = std::max(expires, current_ + 1);
+            node.fn = std::move(fn);
+            link_(index);
+
+            id = (static_cast<TimerId>(node.generation) << 32u) | index;
+            ++active_;
+            wake = node.expires < wake_tick_;
+        }
+
+        if (wake) {
+            cv_.notify_one();
+        }
+        return id;
+    }
+
+    bool TimerWheel::cancel(TimerId id) noexcept {
+        if (id == invalid_timer) {
+            return false;
+        }
+
+        const auto index = static_cast<u32>(id);
+        const auto generation = static_cast<u32>(id >> 32u);
+
+        UniqueTask fn;
+        {
+            std::lock_guard lock{ mutex_ };
+            if (index >= nodes_.size() || nodes_[index].generation != generation || nodes_[index].bucket == npos) {
+                return false;
+            }
+
+            unlink_(index);
+            fn = std::move(nodes_[index].fn);
+            release_(index);
+            --active_;
+        }
+        // fn is destroyed here, outside of the lock, in case its captures are expensive to drop.
+        return true;
+    }
+
+    usize TimerWheel::size() const noexcept {
+        std::lock_guard lock{ mutex_ };
+        return active_;
+    }
+
+    void TimerWheel::link_(u32 index) noexcept {
+        Node& node = nodes_[index];
+        const u64 delta = node.expires - current_;
+
+        usize level = 0;
+        while (level + 1 < level_count && delta >= level_span(level, level_bits)) {
+            ++level;
+        }
+
+        // Timers past the horizon park in the furthest slot of the top level and get re-linked when it cascades.
+        const u64 due = std::min(node.expires, current_ + level_span(level_count - 1, level_bits) - 1);
+        const usize slot = static_cast<usize>(due >> (level * level_bits)) & (slots_per_level - 1);
+        const auto bucket = static_cast<u32>(level * slots_per_level + slot);
+
+        node.bucket = bucket;
+        node.prev = npos;
+        node.next = buckets_[bucket];
+        if (node.next != npos) {
+            nodes_[node.next].prev = index;
+        }
+        buckets_[bucket] = index;
+    }
+
+    void TimerWheel::unlink_(u32 index) noexcept {
+        Node& node = nodes_[index];
+        if (node.prev != npos) {
+            nodes_[node.prev].next = node.next;
+        }
+        else {
+            buckets_[node.bucket] = node.next;
+        }
+
+        if (node.next != npos) {
+            nodes_[node.next].prev = node.prev;
+        }
+        node.bucket = npos;
+    }
+
+    void TimerWheel::release_(u32 index) noexcept {
+        Node& node = nodes_[index];
+        ++node.generation;
+        node.prev = npos;
+        node.next = free_head_;
+        free_head_ = index;
+    }
+
+    void TimerWheel::cascade_(usize level) noexcept {
+        const usize slot = static_cast<usize>(current_ >> (level * level_bits)) & (slots_per_level - 1);
+        const usize bucket = level * slots_per_level + slot;
+
+        u32 index = buckets_[bucket];
+        buckets_[bucket] = npos;
+        while (index != npos) {
+            const u32 next = nodes_[index].next;
+            link_(index);
+            index = next;
+        }
+    }
+
+    void TimerWheel::advance_(std::vector<UniqueTask>& fired) noexcept {
+        ++current_;
+
+        // Moving onto slot 0 of a level means the next coarser slot is now within its range.
+        for (usize level = 1; level < level_count; ++level) {
+            if ((current_ & (level_span(level - 1, level_bits) - 1)) != 0) {
+                break;
+            }
+            cascade_(level);
+        }
+
+        const usize slot = static_cast<usize>(current_) & (slots_per_level - 1);
+        u32 index = buckets_[slot];
+        buckets_[slot] = npos;
+        while (index != npos) {
+            Node& node = nodes_[index];
+            const u32 next = node.next;
+            node.bucket = npos;
+            fired.push_back(std::move(node.fn));
+            release_(index);
+            --active_;
+            index = next;
+        }
+    }
+
+    u64 TimerWheel::next_event_() const noexcept {
+        // Level 0 holds timers due in (current_, current_ + 256], one tick per slot.
+        u64 next = no_tick;
+        for (u64 tick = current_ + 1; tick <= current_ + slots_per_level; ++tick) {
+            if (buckets_[static_cast<usize>(tick) & (slots_per_level - 1)] != npos) {
+                next = tick;
+                break;
+            }
+        }
+
+        // A slot of a coarser level is cascaded at the multiple of its span that it covers.
+        for (usize level = 1; level < level_count; ++level) {
+            const u64 step = level_span(level - 1, level_bits);
+            u64 tick = (current_ / step + 1) * step;
+            for (usize i = 0; i < slots_per_level && tick < next; ++i, tick += step) {
+                const usize slot = static_cast<usize>(tick >> (level * level_bits)) & (slots_per_level - 1);
+                if (buckets_[level * slots_per_level + slot] != npos) {
+                    next = tick;
+                    break;
+                }
+            }
+        }
+        return next;
+    }
+
+    void TimerWheel::run_() noexcept {
+        std::vector<UniqueTask> fired;
+
+        std::unique_lock lock{ mutex_ };
+        while (true) {
+            if (stopping_) {
+                return;
+            }
+
+            if (active_ == 0) {
+                wake_tick_ = no_tick;
+                cv_.wait(lock, [this] { return stopping_ || active_ != 0; });
+                wake_tick_ = 0;
+                continue;
+            }
+
+            const auto now = static_cast<u64>((Clock::now() - epoch_) / tick_);
+            if (current_ >= now) {
+                wake_tick_ = next_event_();
+                cv_.wait_until(lock, epoch_ + tick_ * static_cast<i64>(wake_tick_));
+                wake_tick_ = 0;
+                continue;
+            }
+
+            // Jump over ticks that neither fire nor cascade anything.
+            while (current_ < now && active_ != 0) {
+                const u64 next = next_event_();
+                if (next > now) {
+                    current_ = now;
+                    break;
+                }
+                current_ = next - 1;
+                advance_(fired);
+            }
+            if (active_ == 0) {
+                current_ = now;
+            }
+
+            if (!fired.empty()) {
+                lock.unlock();
+                for (auto& fn : fired) {
+                    fn();
+                }
+                fired.clear();
+                lock.lock();
+            }
+        }
+    }
+
+    TimerWheel& global_timer_wheel() noexcept {
+        static TimerWheel wheel;
+        return wheel;
+    }
+}
@@ -0,0 +1,69 @@
+#include <random>
+#include <vector>
+
+#include <fuwa/assert.hpp>
+
+#include "bench.hpp"
+
+// The same gather loop with a per-element bounds check in three flavours. They are kept out of line so that
+// `objdump -d bench_assert_codegen` shows each loop on its own: EH_ASSERT keeps a compare and branch per
+// element, while EH_DEBUG_ASSERT is only a hint in this NDEBUG build and should match the unchecked loop.
+namespace {
+    [[gnu::noinline]]
+    u64 sum_assert(const u32* values, usize size, const u32* indices, usize count) noexcept {
+        u64 sum = 0;
+        for (usize i = 0; i < count; ++i) {
+            EH_ASSERT(indices[i] < size, "Index out of range");
+            sum += values[indices[i]];
+        }
+        return sum;
+    }
+
+    [[gnu::noinline]]
+    u64 sum_debug_assert(const u32* values, usize size, const u32* indices, usize count) noexcept {
+        u64 sum = 0;
+        for (usize i = 0; i < count; ++i) {
+            EH_DEBUG_ASSERT(indices[i] < size, "Index out of range");
+            sum += values[indices[i]];
+        }
+        return sum;
+    }
+
+    [[gnu::noinline]]
+    u64 sum_unchecked(const u32* values, usize, const u32* indices, usize count) noexcept {
+        u64 sum = 0;
+        for (usize i = 0; i < count; ++i) {
+            sum += values[indices[i]];
+        }
+        return sum;
+    }
+}
+
+// Sums 64M values picked through an index array that fits in L2, so the loop body rather than memory dominates.
+int main() {
+    constexpr usize size = 64 * 1024;
+    constexpr usize count = 1024 * 1024;
+    constexpr u32 rounds = 64;
+
+    std::mt19937_64 rng{ 1 };
+    std::vector<u32> values(size);
+    std::vector<u32> indices(count);
+    for (auto& value : values) {
+        value = static_cast<u32>(rng());
+    }
+    for (auto& index : indices) {
+        index = static_cast<u32>(rng() % size);
+    }
+
+    const auto run = [&](auto sum) {
+        return bench::best_ms(5, [&] {
+            for (u32 r = 0; r < rounds; ++r) {
+                bench::do_not_optimize(sum(values.data(), values.size(), indices.data(), indices.size()));
+            }
+        });
+    };
+
+    bench::report("EH_ASSERT", run(sum_assert));
+    bench::report("EH_DEBUG_ASSERT", run(sum_debug_assert));
+    bench::report("unchecked", run(sum_unchecked));
+}
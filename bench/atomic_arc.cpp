@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "atomic_arc.hpp"
+#include "bench.hpp"
+
+namespace {
+    struct Config {
+        u64 version = 0;
+        u64 payload[7]{};
+    };
+
+    constexpr usize loads_per_thread = 2'000'000;
+
+    // Every reader loads and reads the current config loads_per_thread times while one writer replaces it.
+    template<typename Load, typename Store>
+    double readers_ms(usize readers, Load load, Store store) noexcept {
+        return bench::best_ms(3, [&] {
+            std::atomic<bool> done{ false };
+            std::thread writer{ [&] {
+                for (u64 version = 1; !done.load(std::memory_order_relaxed); ++version) {
+                    store(version);
+                    std::this_thread::sleep_for(std::chrono::microseconds{ 100 });
+                }
+            } };
+
+            std::vector<std::thread> threads;
+            for (usize r = 0; r < readers; ++r) {
+                threads.emplace_back([&] {
+                    u64 sum = 0;
+                    for (usize i = 0; i < loads_per_thread; ++i) {
+                        sum += load();
+                    }
+                    bench::do_not_optimize(sum);
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            done.store(true, std::memory_order_relaxed);
+            writer.join();
+        });
+    }
+}
+
+// Reader scaling of AtomicArc::load() against std::atomic<std::shared_ptr>::load(), which is lock-based in libstdc++.
+int main() {
+    agano::AtomicArc<Config> arc{ agano::make_arc<Config>() };
+    std::atomic<std::shared_ptr<Config>> shared{ std::make_shared<Config>() };
+    std::printf("std::atomic<std::shared_ptr> is_lock_free: %d\n", static_cast<int>(shared.is_lock_free()));
+
+    const usize threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (usize readers = 1; readers <= threads; readers = readers == threads ? threads + 1 : std::min(readers * 2, threads)) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "AtomicArc, %zu readers", readers);
+        bench::report(name, readers_ms(readers,
+            [&] { return arc.load()->version; },
+            [&](u64 version) { arc.store(agano::make_arc<Config>(Config{ version })); }));
+
+        std::snprintf(name, sizeof(name), "atomic<shared_ptr>, %zu readers", readers);
+        bench::report(name, readers_ms(readers,
+            [&] { return shared.load(std::memory_order_acquire)->version; },
+            [&](u64 version) { shared.store(std::make_shared<Config>(Config{ version }), std::memory_order_release); }));
+    }
+    return 0;
+}
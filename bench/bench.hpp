@@ -0,0 +1,31 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <string_view>
+
+#include <fuwa/types.hpp>
+
+namespace bench {
+    // Keeps the compiler from dropping a computation whose result is otherwise unused.
+    template<typename T>
+    inline void do_not_optimize(const T& value) noexcept {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // Best wall time of fn() over the given number of runs, in milliseconds.
+    template<typename F>
+    double best_ms(u32 runs, F&& fn) noexcept {
+        double best = 1e300;
+        for (u32 i = 0; i < runs; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            fn();
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = elapsed.count() < best ? elapsed.count() : best;
+        }
+        return best;
+    }
+
+    inline void report(std::string_view name, double ms) noexcept {
+        std::printf("%-48.*s %10.3f ms\n", static_cast<int>(name.size()), name.data(), ms);
+    }
+}
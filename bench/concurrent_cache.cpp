@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <list>
+#include <optional>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "agano.hpp"
+#include "concurrent_cache.hpp"
+#include "bench.hpp"
+
+namespace {
+    // The LRU this cache replaces: a list in recency order plus an index, all behind one Synced.
+    class LruCache {
+    private:
+        using Order = std::list<std::pair<u64, u64>>;
+
+        usize capacity_;
+        Order order_;
+        std::unordered_map<u64, Order::iterator> index_;
+
+    public:
+        explicit LruCache(usize capacity) noexcept
+            : capacity_{ capacity }
+        {}
+
+        LruCache(LruCache&&) noexcept = default;
+        LruCache& operator=(LruCache&&) noexcept = default;
+
+        std::optional<u64> get(u64 key) noexcept {
+            auto it = index_.find(key);
+            if (it == index_.end()) {
+                return std::nullopt;
+            }
+            order_.splice(order_.begin(), order_, it->second);
+            return it->second->second;
+        }
+
+        void insert(u64 key, u64 value) noexcept {
+            if (auto it = index_.find(key); it != index_.end()) {
+                it->second->second = value;
+                order_.splice(order_.begin(), order_, it->second);
+                return;
+            }
+            if (index_.size() == capacity_) {
+                index_.erase(order_.back().first);
+                order_.pop_back();
+            }
+            order_.emplace_front(key, value);
+            index_.emplace(key, order_.begin());
+        }
+    };
+
+    // Keys 0..n-1 drawn with probability proportional to 1 / (rank + 1)^s.
+    std::vector<u64> zipf_keys(usize n, double s, usize count, u32 seed) noexcept {
+        std::vector<double> cdf(n);
+        double sum = 0.0;
+        for (usize i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            cdf[i] = sum;
+        }
+
+        std::mt19937_64 rng{ seed };
+        std::uniform_real_distribution<double> uniform{ 0.0, sum };
+        std::vector<u64> keys(count);
+        for (auto& key : keys) {
+            key = static_cast<u64>(std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin());
+        }
+        return keys;
+    }
+
+    constexpr usize key_space = 1'000'000;
+    constexpr usize cached_keys = 100'000;
+    constexpr usize lookups_per_thread = 2'000'000;
+
+    // Every thread looks up its own Zipfian key stream and inserts on a miss (read-through).
+    template<typename Lookup>
+    void run(const char* name, usize threads, const std::vector<std::vector<u64>>& streams, Lookup lookup) noexcept {
+        std::atomic<u64> hits{ 0 };
+        const double ms = bench::best_ms(1, [&] {
+            std::vector<std::thread> workers;
+            for (usize t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    u64 local_hits = 0;
+                    for (u64 key : streams[t]) {
+                        local_hits += lookup(key) ? 1u : 0u;
+                    }
+                    hits.fetch_add(local_hits, std::memory_order_relaxed);
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        });
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "%s, %zu threads (hit ratio %.3f)", name, threads,
+                      static_cast<double>(hits.load()) / static_cast<double>(threads * lookups_per_thread));
+        bench::report(label, ms);
+    }
+}
+
+template<>
+inline constexpr bool agano::send_tag_v<LruCache> = true;
+
+// Zipfian (s = 0.99) read-through workload over 1M keys with room for 100k: ConcurrentCache against a Synced LRU.
+int main() {
+    const usize max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<std::vector<u64>> streams;
+    for (usize t = 0; t < max_threads; ++t) {
+        streams.push_back(zipf_keys(key_space, 0.99, lookups_per_thread, static_cast<u32>(t + 1)));
+    }
+
+    for (usize threads = 1; threads <= max_threads; threads = threads == max_threads ? max_threads + 1 : std::min(threads * 2, max_threads)) {
+        {
+            agano::Synced<LruCache> lru{ LruCache{ cached_keys } };
+            run("Synced LRU", threads, streams, [&](u64 key) {
+                auto locked = lru.lock();
+                if (locked->get(key)) {
+                    return true;
+                }
+                locked->insert(key, key);
+                return false;
+            });
+        }
+        {
+            agano::ConcurrentCache<u64, u64> cache{ { .capacity_bytes = cached_keys * 16u } };
+            run("ConcurrentCache", threads, streams, [&](u64 key) {
+                if (cache.get(key)) {
+                    return true;
+                }
+                static_cast<void>(cache.insert(key, key));
+                return false;
+            });
+        }
+    }
+    return 0;
+}
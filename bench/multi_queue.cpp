@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "multi_queue.hpp"
+#include "bench.hpp"
+
+namespace {
+    // Counts the keys still in the queue; rank(k) is how many remaining keys are better than k.
+    class Fenwick {
+    private:
+        std::vector<u32> tree_;
+
+    public:
+        explicit Fenwick(usize size) noexcept
+            : tree_(size + 1, 0)
+        {}
+
+        void add(usize index, i32 delta) noexcept {
+            for (++index; index < tree_.size(); index += index & (~index + 1)) {
+                tree_[index] = static_cast<u32>(static_cast<i32>(tree_[index]) + delta);
+            }
+        }
+
+        // Number of keys in [0, index).
+        u64 prefix(usize index) const noexcept {
+            u64 sum = 0;
+            for (; index > 0; index -= index & (~index + 1)) {
+                sum += tree_[index];
+            }
+            return sum;
+        }
+    };
+
+    // Mean and worst rank of what pop() returns, with a steady-state queue of `live` keys.
+    // The queue is a max-queue, so the rank of k is the number of remaining keys greater than k.
+    void rank_error(usize heaps, usize choices) noexcept {
+        constexpr usize live = 100'000;
+        constexpr usize operations = 1'000'000;
+
+        agano::MultiQueue<u32> queue{ heaps, 1, choices };
+        Fenwick remaining{ live + operations };
+        std::vector<u32> keys(live + operations);
+        std::iota(keys.begin(), keys.end(), 0u);
+        std::shuffle(keys.begin(), keys.end(), std::mt19937{ 7 });
+
+        usize next = 0;
+        for (; next < live; ++next) {
+            queue.push(keys[next]);
+            remaining.add(keys[next], 1);
+        }
+
+        u64 total_rank = 0;
+        u64 worst_rank = 0;
+        for (usize i = 0; i < operations; ++i) {
+            const u32 key = *queue.try_pop();
+            remaining.add(key, -1);
+            const u64 rank = (live - 1) - remaining.prefix(key + 1);
+            total_rank += rank;
+            worst_rank = std::max(worst_rank, rank);
+
+            queue.push(keys[next]);
+            remaining.add(keys[next], 1);
+            ++next;
+        }
+
+        std::printf("rank error, %3zu heaps, %zu choices: mean %8.2f, max %6llu\n",
+                    heaps, choices, static_cast<double>(total_rank) / operations, static_cast<unsigned long long>(worst_rank));
+    }
+
+    // Every thread alternates push and pop on the shared queue.
+    template<typename Queue>
+    double throughput_ms(Queue& queue, usize threads) noexcept {
+        constexpr usize operations = 4'000'000;
+        return bench::best_ms(3, [&] {
+            std::vector<std::thread> workers;
+            for (usize t = 0; t < threads; ++t) {
+                workers.emplace_back([&queue, threads, t] {
+                    std::mt19937 rng{ static_cast<u32>(t) };
+                    for (usize i = 0; i < operations / threads; ++i) {
+                        queue.push(rng());
+                        bench::do_not_optimize(queue.try_pop());
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        });
+    }
+
+    // Baseline: one std::priority_queue behind a mutex.
+    class LockedHeap {
+    private:
+        std::mutex mutex_;
+        std::priority_queue<u32> heap_;
+
+    public:
+        void push(u32 value) noexcept {
+            std::lock_guard lock{ mutex_ };
+            heap_.push(value);
+        }
+
+        std::optional<u32> try_pop() noexcept {
+            std::lock_guard lock{ mutex_ };
+            if (heap_.empty()) {
+                return std::nullopt;
+            }
+            const u32 value = heap_.top();
+            heap_.pop();
+            return value;
+        }
+    };
+}
+
+// Relaxation (rank error) for a range of heap counts and choices, then push/pop throughput against a locked heap.
+int main() {
+    for (usize heaps : { 4u, 16u, 64u }) {
+        for (usize choices : { 1u, 2u, 4u }) {
+            rank_error(heaps, choices);
+        }
+    }
+
+    const usize threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (usize t = 1; t <= threads; t = t == threads ? threads + 1 : std::min(t * 2, threads)) {
+        char name[64];
+        {
+            LockedHeap queue;
+            std::snprintf(name, sizeof(name), "locked priority_queue, %zu threads", t);
+            bench::report(name, throughput_ms(queue, t));
+        }
+        {
+            agano::MultiQueue<u32> queue;
+            std::snprintf(name, sizeof(name), "MultiQueue (%zu heaps), %zu threads", queue.heap_count(), t);
+            bench::report(name, throughput_ms(queue, t));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#if defined(AGANO_BENCH_EXECUTION_PAR)
+#include <execution>
+#endif
+
+#include "parallel.hpp"
+#include "bench.hpp"
+
+// parallel_sort and parallel_inclusive_scan against the sequential std algorithms and, when the
+// standard library has a backend for them, the std::execution::par overloads.
+int main() {
+    constexpr usize n = 1u << 24u;
+    constexpr u32 runs = 5;
+
+    std::mt19937_64 rng{ 1 };
+    std::vector<u64> input(n);
+    for (auto& value : input) {
+        value = rng();
+    }
+    std::vector<u64> data(n);
+
+    std::printf("%zu elements, %u hardware threads\n", n, std::thread::hardware_concurrency());
+
+    bench::report("std::sort", bench::best_ms(runs, [&] {
+        data = input;
+        std::sort(data.begin(), data.end());
+    }));
+#if defined(AGANO_BENCH_EXECUTION_PAR)
+    bench::report("std::sort(par)", bench::best_ms(runs, [&] {
+        data = input;
+        std::sort(std::execution::par, data.begin(), data.end());
+    }));
+#endif
+    bench::report("agano::parallel_sort", bench::best_ms(runs, [&] {
+        data = input;
+        agano::parallel_sort(data.begin(), data.end());
+    }));
+
+    bench::report("std::inclusive_scan", bench::best_ms(runs, [&] {
+        std::inclusive_scan(input.begin(), input.end(), data.begin());
+        bench::do_not_optimize(data.back());
+    }));
+#if defined(AGANO_BENCH_EXECUTION_PAR)
+    bench::report("std::inclusive_scan(par)", bench::best_ms(runs, [&] {
+        std::inclusive_scan(std::execution::par, input.begin(), input.end(), data.begin());
+        bench::do_not_optimize(data.back());
+    }));
+#endif
+    bench::report("agano::parallel_inclusive_scan", bench::best_ms(runs, [&] {
+        agano::parallel_inclusive_scan(input.begin(), input.end(), data.begin());
+        bench::do_not_optimize(data.back());
+    }));
+}
@@ -0,0 +1,102 @@
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "persistent_map.hpp"
+#include "bench.hpp"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+#if defined(__GLIBC__)
+    constexpr bool has_memory_report = true;
+
+    // Bytes handed out by glibc malloc that are still in use.
+    double live_mib() noexcept {
+        return static_cast<double>(mallinfo2().uordblks) / (1024.0 * 1024.0);
+    }
+#else
+    // Only glibc reports the bytes in use; elsewhere the bench prints timings only.
+    constexpr bool has_memory_report = false;
+
+    double live_mib() noexcept {
+        return 0.0;
+    }
+#endif
+
+    void report_memory(const char* name, double amount, const char* unit) noexcept {
+        if constexpr (has_memory_report) {
+            std::printf("%-48s %10.1f %s\n", name, amount, unit);
+        }
+    }
+}
+
+// Memory and update throughput of a 1M-entry PersistentMap against copying a std::unordered_map per update.
+int main() {
+    constexpr usize count = 1'000'000;
+    constexpr usize updates = 100'000;
+    constexpr usize kept_snapshots = 1000;
+    using Map = agano::PersistentMap<u64, u64>;
+
+    const double baseline = live_mib();
+    Map map;
+    bench::report("transient load of 1M entries", bench::best_ms(1, [&] {
+        auto transient = Map{}.transient();
+        for (u64 key = 0; key < count; ++key) {
+            transient.insert(key, key);
+        }
+        map = std::move(transient).persistent();
+    }));
+    report_memory("1M entries, PersistentMap", live_mib() - baseline, "MiB");
+
+    {
+        const double before = live_mib();
+        std::unordered_map<u64, u64> hash_map;
+        hash_map.reserve(count);
+        for (u64 key = 0; key < count; ++key) {
+            hash_map.emplace(key, key);
+        }
+        report_memory("1M entries, std::unordered_map", live_mib() - before, "MiB");
+
+        bench::report("10 updates copying std::unordered_map", bench::best_ms(1, [&] {
+            for (u64 i = 0; i < 10; ++i) {
+                auto copy = hash_map;
+                copy[i] = i + 1;
+                bench::do_not_optimize(copy.size());
+            }
+        }));
+    }
+
+    std::mt19937_64 rng{ 3 };
+    bench::report("100k persistent updates, snapshot each", bench::best_ms(1, [&] {
+        Map current = map;
+        for (usize i = 0; i < updates; ++i) {
+            const Map next = current.insert(rng() % count, i);
+            current = next;
+        }
+        bench::do_not_optimize(current.size());
+    }));
+
+    bench::report("100k in-place updates of an unshared map", bench::best_ms(1, [&] {
+        Map current = map;
+        current = std::move(current).insert(0, 0);
+        for (usize i = 0; i < updates; ++i) {
+            current = std::move(current).insert(rng() % count, i);
+        }
+        bench::do_not_optimize(current.size());
+    }));
+
+    {
+        // Retained snapshots only cost the nodes on their changed paths.
+        const double before = live_mib();
+        std::vector<Map> snapshots{ map };
+        for (usize i = 0; i < kept_snapshots; ++i) {
+            snapshots.push_back(snapshots.back().insert(rng() % count, i));
+        }
+        report_memory("extra memory per retained snapshot", (live_mib() - before) * 1024.0 / static_cast<double>(kept_snapshots), "KiB");
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "timer_wheel.hpp"
+#include "bench.hpp"
+
+// Process CPU time comes from getrusage, so the idle measurement is POSIX only.
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+
+namespace {
+    double cpu_ms() noexcept {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3
+            + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+    }
+}
+#endif
+
+// Schedules and cancels 10M timers, fires 1M of them, and measures the CPU an idle wheel burns.
+int main() {
+    using namespace std::chrono_literals;
+    constexpr usize count = 10'000'000;
+
+    {
+        agano::TimerWheel wheel;
+        std::mt19937_64 rng{ 1 };
+        std::vector<agano::TimerWheel::TimerId> ids(count);
+
+        // Delays between 1s and 1h spread the timers over every level; none fires during the run.
+        bench::report("schedule 10M timers", bench::best_ms(1, [&] {
+            for (auto& id : ids) {
+                id = wheel.schedule_after(std::chrono::milliseconds{ 1000 + rng() % 3'600'000 }, [] {});
+            }
+        }));
+        bench::report("cancel 10M timers", bench::best_ms(1, [&] {
+            for (auto id : ids) {
+                static_cast<void>(wheel.cancel(id));
+            }
+        }));
+    }
+
+    {
+        agano::TimerWheel wheel;
+        std::mt19937_64 rng{ 2 };
+        std::atomic<usize> fired{ 0 };
+        bench::report("fire 1M timers due within 200ms", bench::best_ms(1, [&] {
+            for (usize i = 0; i < count / 10; ++i) {
+                wheel.schedule_after(std::chrono::microseconds{ rng() % 200'000 }, [&fired] {
+                    fired.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            while (fired.load(std::memory_order_relaxed) != count / 10) {
+                std::this_thread::sleep_for(1ms);
+            }
+        }));
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    {
+        // A single far timer: the service thread should sleep through, not wake every tick.
+        agano::TimerWheel wheel{ 10us };
+        wheel.schedule_after(1h, [] {});
+        std::this_thread::sleep_for(10ms);
+        const double before = cpu_ms();
+        std::this_thread::sleep_for(1s);
+        bench::report("idle wheel CPU over 1s, 10us tick", cpu_ms() - before);
+    }
+#endif
+}
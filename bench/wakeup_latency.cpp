@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "channel.hpp"
+#include "wait_strategy.hpp"
+#include "bench.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // One-way latency from a push to the return of the consumer's blocked pop(), in nanoseconds.
+    template<typename Wait>
+    void measure(const char* name, Wait wait) noexcept {
+        constexpr usize samples = 2000;
+
+        agano::Channel<i64, Wait> channel{ 16, wait };
+        std::vector<i64> latencies;
+        latencies.reserve(samples);
+        std::atomic<usize> received{ 0 };
+
+        std::thread consumer{ [&] {
+            while (auto sent = channel.pop()) {
+                latencies.push_back(Clock::now().time_since_epoch().count() - *sent);
+                received.store(latencies.size(), std::memory_order_release);
+            }
+        } };
+
+        for (usize i = 0; i < samples; ++i) {
+            // Give the consumer time to block (or start spinning) before the next item.
+            std::this_thread::sleep_for(std::chrono::microseconds{ 50 });
+            static_cast<void>(channel.push(Clock::now().time_since_epoch().count()));
+            while (received.load(std::memory_order_acquire) != i + 1) {
+                std::this_thread::yield();
+            }
+        }
+        channel.close();
+        consumer.join();
+
+        std::sort(latencies.begin(), latencies.end());
+        std::printf("%-20s p50 %8lld ns   p99 %8lld ns\n", name,
+            static_cast<long long>(latencies[samples / 2]), static_cast<long long>(latencies[samples * 99 / 100]));
+    }
+}
+
+// Spinning strategies only pay off with a core per waiting thread; on an oversubscribed machine they lose.
+int main() {
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    measure("BlockingWait", agano::BlockingWait{});
+    measure("SpinThenParkWait", agano::SpinThenParkWait{});
+    measure("SpinThenYieldWait", agano::SpinThenYieldWait{});
+    measure("YieldingWait", agano::YieldingWait{});
+    if (std::thread::hardware_concurrency() > 1) {
+        measure("BusySpinWait", agano::BusySpinWait{});
+    }
+}
@@ -0,0 +1,92 @@
+#include <cassert>
+#include <string_view>
+
+#include <fuwa/assert.hpp>
+#include <fuwa/result.hpp>
+
+#include "atomic_bitmap.hpp"
+
+// Checking that something aborts needs a child process to abort in; on other targets only the passing cases run.
+#if defined(__unix__) || defined(__APPLE__)
+    #define AGANO_EXAMPLE_FORK 1
+#else
+    #define AGANO_EXAMPLE_FORK 0
+#endif
+
+#if AGANO_EXAMPLE_FORK
+#include <csignal>
+
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+enum class ParseError : u32 {
+    eNone = 0,
+    eInvalid,
+};
+
+template<>
+struct eh::ErrorTypeTrait<ParseError> {
+    static std::string_view description(ParseError) noexcept { return "invalid input"; }
+    static std::string_view stringify(ParseError) noexcept { return "eInvalid"; }
+    static ParseError default_value() noexcept { return ParseError::eNone; }
+};
+
+#if AGANO_EXAMPLE_FORK
+// Runs fn in a child process and reports whether it died of abort().
+template<typename F>
+bool aborts(F fn) noexcept {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        fn();
+        _exit(0);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+#endif
+
+u32 low_byte(u32 x) noexcept {
+    EH_ASSUME(x < 256u);
+    return x & 0xffu;
+}
+
+// Conditions that hold are free of observable effects; the examples are debug builds, so broken ones panic.
+void debug_checks() noexcept {
+    EH_DEBUG_ASSERT(1 + 1 == 2, "Arithmetic is broken");
+    assert(low_byte(200u) == 200u);
+
+    eh::Result<int, ParseError> parsed{ 42 };
+    assert(std::move(parsed).unwrap_unchecked() == 42);
+
+#if AGANO_EXAMPLE_FORK
+    assert(aborts([] { EH_DEBUG_ASSERT(1 + 1 == 3, "Expected to fire"); }));
+    assert(aborts([] { EH_UNREACHABLE(); }));
+    assert(aborts([] {
+        eh::Result<int, ParseError> failed{ eh::Error<ParseError>{ ParseError::eInvalid } };
+        static_cast<void>(std::move(failed).unwrap_unchecked());
+    }));
+#endif
+}
+
+// IdAllocator takes ids from its callers, so its bounds checks stay on even where EH_DEBUG_ASSERT would not.
+void id_bounds() noexcept {
+    agano::IdAllocator ids{ 10 };
+    const auto id = ids.allocate();
+    assert(id.has_value() && ids.is_allocated(*id));
+    ids.free(*id);
+    assert(!ids.is_allocated(*id));
+
+#if AGANO_EXAMPLE_FORK
+    assert(aborts([&] { ids.free(10); }));
+    assert(aborts([&] { static_cast<void>(ids.is_allocated(64)); }));
+    assert(aborts([&] { ids.free(*id); }));
+#endif
+}
+
+int main() {
+    debug_checks();
+    id_bounds();
+}
@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "agano.hpp"
+#include "atomic_arc.hpp"
+
+struct Config {
+    int version = 0;
+    std::string name;
+};
+
+template<>
+inline constexpr bool agano::send_tag_v<Config> = true;
+
+template<>
+inline constexpr bool agano::send_tag_v<const Config&> = true;
+
+static_assert(agano::Send<agano::Arc<Config>> && agano::Sync<agano::Arc<Config>>);
+static_assert(agano::Sync<agano::AtomicArc<Config>>);
+
+// store, exchange and compare_exchange replace the value; handles loaded earlier keep theirs.
+void swap_operations() noexcept {
+    agano::AtomicArc<Config> current{ agano::make_arc<Config>(Config{ 1, "one" }) };
+    assert(current.is_lock_free());
+
+    const agano::Arc<Config> first = current.load();
+    assert(first->version == 1 && first.same_as(current.load()));
+
+    current.store(agano::make_arc<Config>(Config{ 2, "two" }));
+    assert(first->name == "one" && current.load()->version == 2);
+
+    const agano::Arc<Config> second = current.exchange(agano::make_arc<Config>(Config{ 3, "three" }));
+    assert(second->version == 2 && current.load()->version == 3);
+
+    // Fails against a stale handle and refreshes it, then succeeds.
+    agano::Arc<Config> expected = second;
+    assert(!current.compare_exchange(expected, agano::make_arc<Config>(Config{ 4, "four" })));
+    assert(expected->version == 3);
+    assert(current.compare_exchange(expected, agano::make_arc<Config>(Config{ 4, "four" })));
+    assert(current.load()->version == 4);
+
+    agano::AtomicArc<Config> empty;
+    assert(!empty.load());
+}
+
+// Far more loads than one refcount batch, racing a writer: every loaded config is whole and versions never go back.
+void readers_and_writer() noexcept {
+    constexpr int versions = 1000;
+    agano::AtomicArc<Config> current{ agano::make_arc<Config>(Config{ 0, "0" }) };
+    std::atomic<bool> done{ false };
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            int last = 0;
+            usize loads = 0;
+            while (!done.load(std::memory_order_acquire) || loads < 100'000) {
+                const agano::Arc<Config> config = current.load();
+                assert(config->name == std::to_string(config->version));
+                assert(config->version >= last);
+                last = config->version;
+                ++loads;
+            }
+        });
+    }
+
+    for (int version = 1; version <= versions; ++version) {
+        current.store(agano::make_arc<Config>(Config{ version, std::to_string(version) }));
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    assert(current.load()->version == versions);
+}
+
+int main() {
+    swap_operations();
+    readers_and_writer();
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+#include "atomic_bitmap.hpp"
+
+// Single bits, ranges across word boundaries, and a size that is not a multiple of 64.
+void bits_and_ranges() noexcept {
+    agano::AtomicBitmap bitmap{ 200 };
+    assert(bitmap.size() == 200 && bitmap.count() == 0);
+
+    // set() and clear() return the previous value of the bit.
+    assert(!bitmap.set(3) && bitmap.set(3) && bitmap.test(3));
+    assert(bitmap.clear(3) && !bitmap.clear(3) && !bitmap.test(3));
+
+    bitmap.set_range(60, 80);
+    assert(bitmap.count() == 80);
+    assert(!bitmap.test(59) && bitmap.test(60) && bitmap.test(139) && !bitmap.test(140));
+
+    bitmap.clear_range(64, 64);
+    assert(bitmap.count() == 16 && !bitmap.test(100) && bitmap.test(130));
+
+    bitmap.set_range(0, 200);
+    assert(bitmap.count() == 200);
+    // The padding bits past 200 are never handed out.
+    assert(!bitmap.find_first_zero_and_set().has_value());
+}
+
+// A bitmap larger than one summary word fills up exactly, then hands out freed bits again.
+void fill_and_reuse() noexcept {
+    constexpr usize size = 64 * 64 * 3 + 17;
+    agano::AtomicBitmap bitmap{ size };
+    std::vector<bool> seen(size, false);
+    for (usize i = 0; i < size; ++i) {
+        const auto index = bitmap.find_first_zero_and_set();
+        assert(index.has_value() && *index < size && !seen[*index]);
+        seen[*index] = true;
+    }
+    assert(!bitmap.find_first_zero_and_set().has_value());
+
+    assert(bitmap.clear(5000));
+    assert(bitmap.find_first_zero_and_set() == 5000);
+}
+
+// Threads allocate and free ids concurrently; no id is ever held by two threads at once.
+void concurrent_ids() noexcept {
+    constexpr usize capacity = 256;
+    constexpr int threads = 4;
+    constexpr int rounds = 20'000;
+    agano::IdAllocator ids{ capacity };
+    std::vector<std::atomic<int>> owners(capacity);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::vector<usize> held;
+            for (int i = 0; i < rounds; ++i) {
+                if (const auto id = ids.allocate()) {
+                    int expected = 0;
+                    assert(owners[*id].compare_exchange_strong(expected, t + 1));
+                    assert(ids.is_allocated(*id));
+                    held.push_back(*id);
+                }
+                if (held.size() > 32 || (i % 3 == 0 && !held.empty())) {
+                    owners[held.back()].store(0);
+                    ids.free(held.back());
+                    held.pop_back();
+                }
+            }
+            for (usize id : held) {
+                owners[id].store(0);
+                ids.free(id);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    assert(ids.allocated() == 0 && ids.capacity() == capacity);
+}
+
+int main() {
+    bits_and_ranges();
+    fill_and_reuse();
+    concurrent_ids();
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "broadcast.hpp"
+
+// Every reader sees every item, in order, whichever wait strategy the ring uses.
+template<typename Wait>
+void fan_out(u64 count) noexcept {
+    using Ring = agano::BroadcastRing<u64, Wait>;
+    Ring ring{ 64, 4 };
+
+    std::vector<typename Ring::Reader> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.push_back(*ring.subscribe());
+    }
+
+    std::vector<std::thread> threads;
+    for (auto& reader : readers) {
+        threads.emplace_back([&reader, count] {
+            u64 expected = 0;
+            while (reader.read([&](const u64& value) { assert(value == expected++); }, 7) != 0) {}
+            assert(expected == count);
+        });
+    }
+
+    for (u64 i = 0; i < count / 2; ++i) {
+        ring.publish(u64{ i });
+    }
+    std::vector<u64> batch;
+    for (u64 i = count / 2; i < count; ++i) {
+        batch.push_back(i);
+    }
+    ring.publish(batch.begin(), batch.end());
+    ring.close();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Readers that subscribe while the producer runs must see a gap-free suffix of the stream.
+void late_subscribers() noexcept {
+    agano::BroadcastRing<u64> ring{ 8, 2 };
+    constexpr u64 count = 200'000;
+
+    std::thread producer{ [&] {
+        for (u64 i = 0; i < count; ++i) {
+            ring.publish(u64{ i });
+        }
+        ring.close();
+    } };
+
+    std::thread late{ [&] {
+        while (true) {
+            auto reader = ring.subscribe();
+            assert(reader);
+
+            bool first = true;
+            u64 expected = 0;
+            const usize read = reader->read([&](const u64& value) {
+                assert(first || value == expected);
+                first = false;
+                expected = value + 1;
+            }, 16);
+            if (read == 0) {
+                return;
+            }
+
+            // Moving the reader out leaves an empty handle behind.
+            auto moved = std::move(*reader);
+            assert(reader->available() == 0);
+            static_cast<void>(moved.try_read([&](const u64& value) { assert(value == expected++); }));
+        }
+    } };
+
+    producer.join();
+    late.join();
+}
+
+int main() {
+    fan_out<agano::BlockingWait>(200'000);
+    // Spinning readers are slow when there are fewer cores than threads.
+    fan_out<agano::YieldingWait>(20'000);
+    fan_out<agano::BusySpinWait>(20'000);
+    late_subscribers();
+}
@@ -0,0 +1,127 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "concurrent_cache.hpp"
+
+using namespace std::chrono_literals;
+
+// Charges strings by their length, so the capacity is a byte budget for the payload.
+struct LengthWeigher {
+    usize operator()(int, const std::string& value) const noexcept {
+        return value.size();
+    }
+};
+
+using StringCache = agano::ConcurrentCache<int, std::string, std::hash<int>, std::equal_to<int>, LengthWeigher>;
+
+void basic_operations() noexcept {
+    StringCache cache{ { .capacity_bytes = 1000, .shard_count = 4 } };
+    assert(!cache.get(1).has_value());
+
+    assert(cache.insert(1, "one"));
+    assert(cache.insert(2, "two"));
+    assert(cache.get(1) == std::string{ "one" } && cache.contains(2));
+
+    assert(cache.insert(1, "uno"));
+    assert(cache.get(1) == std::string{ "uno" });
+
+    assert(cache.erase(2) && !cache.erase(2) && !cache.contains(2));
+    // Heavier than a whole shard.
+    assert(!cache.insert(3, std::string(300, 'x')));
+
+    const auto stats = cache.stats();
+    assert(stats.hits == 2 && stats.misses == 1);
+    assert(stats.entries == 1 && stats.bytes == 3);
+
+    cache.clear();
+    assert(cache.stats().entries == 0 && !cache.contains(1));
+}
+
+// A referenced entry gets a second chance; the unreferenced one is evicted to make room.
+void clock_second_chance() noexcept {
+    StringCache cache{ { .capacity_bytes = 20, .shard_count = 1 } };
+    assert(cache.insert(1, std::string(10, 'a')));
+    assert(cache.insert(2, std::string(10, 'b')));
+    assert(cache.get(1).has_value());
+
+    assert(cache.insert(3, std::string(10, 'c')));
+    assert(cache.contains(1) && !cache.contains(2) && cache.contains(3));
+    assert(cache.stats().evictions == 1 && cache.stats().bytes == 20);
+
+    // Replacing an entry frees its old weight first, so it evicts nothing.
+    assert(cache.insert(3, std::string(10, 'C')));
+    assert(cache.stats().evictions == 1);
+}
+
+// Expired entries miss and are the first to go when room is needed.
+void ttl_expiry() noexcept {
+    agano::ConcurrentCache<int, int> cache{ { .capacity_bytes = 2 * 8, .shard_count = 1, .default_ttl = 20ms } };
+    assert(cache.insert(1, 1));
+    assert(cache.insert(2, 2, 0ns));
+    assert(cache.get(1) == 1);
+
+    // The coarse clock ticks every few milliseconds.
+    std::this_thread::sleep_for(60ms);
+    assert(!cache.get(1).has_value() && cache.get(2) == 2);
+
+    // Entry 2 was just referenced, so the hand evicts the expired entry.
+    assert(cache.insert(3, 3));
+    assert(cache.stats().expirations == 1 && cache.stats().evictions == 0);
+    assert(cache.contains(2) && cache.contains(3));
+}
+
+// Readers hit entries while writers keep replacing and evicting them; every value read is the one written for its key.
+void concurrent_readers_and_writers() noexcept {
+    constexpr int keys = 2000;
+    agano::ConcurrentCache<int, std::string> cache{ { .capacity_bytes = 500 * (sizeof(int) + sizeof(std::string)), .shard_count = 4 } };
+    std::atomic<bool> done{ false };
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < 3; ++r) {
+        threads.emplace_back([&, r] {
+            u32 key = static_cast<u32>(r);
+            while (!done.load(std::memory_order_acquire)) {
+                key = key * 1103515245u + 12345u;
+                const int k = static_cast<int>(key % keys);
+                if (const auto value = cache.get(k)) {
+                    assert(*value == std::to_string(k));
+                }
+            }
+        });
+    }
+    for (int w = 0; w < 2; ++w) {
+        threads.emplace_back([&, w] {
+            for (int round = 0; round < 20; ++round) {
+                for (int k = w; k < keys; k += 2) {
+                    assert(cache.insert(k, std::to_string(k)));
+                }
+                for (int k = w; k < keys; k += 16) {
+                    static_cast<void>(cache.erase(k));
+                }
+            }
+        });
+    }
+    for (usize i = 3; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    done.store(true, std::memory_order_release);
+    for (usize i = 0; i < 3; ++i) {
+        threads[i].join();
+    }
+
+    const auto stats = cache.stats();
+    assert(stats.bytes <= cache.capacity_bytes() && stats.evictions > 0);
+    assert(stats.hits + stats.misses > 0);
+}
+
+int main() {
+    basic_operations();
+    clock_second_chance();
+    ttl_expiry();
+    concurrent_readers_and_writers();
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <atomic>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "concurrent_vector.hpp"
+
+// Elements never move: a reference taken early stays valid while many more segments are added.
+void stable_references() noexcept {
+    agano::ConcurrentVector<std::string> vector;
+    const usize first = vector.push_back("first");
+    const std::string* address = &vector[first];
+
+    for (int i = 0; i < 10'000; ++i) {
+        vector.emplace_back(std::to_string(i));
+    }
+    assert(&vector[first] == address && *address == "first");
+    assert(vector.size() == 10'001 && vector[10'000] == "9999");
+
+    const usize block = vector.grow_by(100, std::string{ "x" });
+    assert(block == 10'001 && vector.size() == 10'101 && vector[10'100] == "x");
+    assert(vector.get(vector.size()) == nullptr);
+}
+
+// Threads append concurrently while a reader walks the published prefix; every pushed value shows up once.
+void concurrent_appends() noexcept {
+    constexpr int per_thread = 50'000;
+    constexpr int threads = 4;
+    agano::ConcurrentVector<int> vector;
+    std::atomic<bool> done{ false };
+
+    std::thread reader{ [&] {
+        while (!done.load(std::memory_order_acquire)) {
+            vector.for_each([](usize, int value) {
+                assert(value >= 0 && value < per_thread * threads);
+            });
+        }
+    } };
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; ++t) {
+        writers.emplace_back([&, t] {
+            for (int i = 0; i < per_thread; ++i) {
+                const usize index = vector.push_back(t * per_thread + i);
+                assert(vector[index] == t * per_thread + i);
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    done.store(true, std::memory_order_release);
+    reader.join();
+
+    std::vector<int> seen(per_thread * threads, 0);
+    vector.for_each([&](usize, int value) { ++seen[value]; });
+    assert(vector.size() == seen.size());
+    for (int count : seen) {
+        assert(count == 1);
+    }
+}
+
+int main() {
+    stable_references();
+    concurrent_appends();
+    return 0;
+}
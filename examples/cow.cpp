@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+#include "agano.hpp"
+#include "cow.hpp"
+
+template<>
+inline constexpr bool agano::send_tag_v<std::vector<int>> = true;
+
+template<>
+inline constexpr bool agano::send_tag_v<const std::vector<int>&> = true;
+
+// Can be moved to another thread but not shared between threads, so handles to it must not cross threads either.
+struct SendOnly {
+    int value = 0;
+};
+
+template<>
+inline constexpr bool agano::send_tag_v<SendOnly> = true;
+
+static_assert(agano::Send<agano::Cow<std::vector<int>>> && agano::Sync<agano::Cow<std::vector<int>>>);
+static_assert(agano::Send<SendOnly> && !agano::Sync<SendOnly>);
+static_assert(!agano::Send<agano::Cow<SendOnly>> && !agano::Sync<agano::Cow<SendOnly>>);
+
+// Copies share the value; make_mut() clones only while the value is shared.
+void clone_on_write() noexcept {
+    agano::Cow<std::vector<int>> original{ std::vector<int>{ 1, 2, 3 } };
+    agano::Cow<std::vector<int>> copy = original;
+    assert(copy.same_as(original));
+    assert(original.use_count() == 2 && !original.is_unique());
+
+    copy.make_mut().push_back(4);
+    assert(!copy.same_as(original));
+    assert(original->size() == 3 && copy->size() == 4);
+    assert(original.is_unique() && copy.is_unique());
+
+    const std::vector<int>* before = &*copy;
+    copy.make_mut().push_back(5);
+    assert(&*copy == before);
+
+    agano::Cow<std::vector<int>> moved = std::move(copy);
+    assert(copy.is_empty() && moved->size() == 5);
+
+    const agano::Arc<std::vector<int>> shared = moved.share();
+    assert(moved.use_count() == 2 && shared->size() == 5);
+}
+
+// Readers always see a whole version while a writer publishes new ones next to them.
+void snapshots_under_writes() noexcept {
+    constexpr int versions = 2000;
+    agano::Synced<agano::Cow<std::vector<int>>> current{ agano::make_cow<std::vector<int>>(64, 0) };
+    std::atomic<bool> done{ false };
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            int last = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                const auto snapshot = agano::snapshot(current);
+                const int version = snapshot->front();
+                assert(std::all_of(snapshot->begin(), snapshot->end(), [version](int value) { return value == version; }));
+                assert(version >= last);
+                last = version;
+            }
+        });
+    }
+
+    for (int version = 1; version <= versions; ++version) {
+        auto next = agano::snapshot(current);
+        auto& values = next.make_mut();
+        std::fill(values.begin(), values.end(), version);
+        agano::publish(current, std::move(next));
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    assert(agano::snapshot(current)->back() == versions);
+}
+
+int main() {
+    clone_on_write();
+    snapshots_under_writes();
+    return 0;
+}
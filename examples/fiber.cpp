@@ -0,0 +1,74 @@
+#include <atomic>
+#include <cassert>
+#include <memory>
+
+#include "fiber.hpp"
+
+// Fibers need one of the hand-written context switches; on other targets there is nothing to check.
+#if AGANO_HAS_FIBERS
+
+template<>
+inline constexpr bool agano::send_tag_v<long> = true;
+
+// A fiber that yields while holding a FiberMutex must not let another fiber into the critical section.
+void mutex_across_yields() noexcept {
+    agano::FiberSynced<long> counter{ 0 };
+    {
+        agano::FiberScheduler scheduler{ 3, 64u * 1024u };
+        for (int f = 0; f < 2000; ++f) {
+            scheduler.spawn([&] {
+                // Floating point state must survive the switches as well.
+                double factor = 1.5;
+                for (int i = 0; i < 100; ++i) {
+                    {
+                        auto locked = counter.lock();
+                        const long value = *locked;
+                        agano::this_fiber::yield();
+                        *locked = value + 1;
+                    }
+                    factor *= 1.0001;
+                }
+                assert(factor > 1.5);
+            });
+        }
+        scheduler.wait_idle();
+        assert(*counter.lock() == 200'000);
+
+        // Fibers still queued when the scheduler goes away are run to completion.
+        for (int f = 0; f < 100; ++f) {
+            scheduler.spawn([&] {
+                for (int i = 0; i < 100; ++i) {
+                    *counter.lock() += 1;
+                    agano::this_fiber::yield();
+                }
+            });
+        }
+    }
+    assert(*counter.lock() == 210'000);
+}
+
+// Fiber bodies may own move-only state.
+void move_only_fibers() noexcept {
+    std::atomic<int> sum{ 0 };
+    {
+        agano::FiberScheduler scheduler{ 2 };
+        for (int i = 0; i < 10; ++i) {
+            scheduler.spawn([&sum, value = std::make_unique<int>(i)] {
+                assert(agano::this_fiber::is_fiber());
+                sum += *value;
+            });
+        }
+        scheduler.wait_idle();
+    }
+    assert(sum == 45);
+    assert(!agano::this_fiber::is_fiber());
+}
+
+#endif
+
+int main() {
+#if AGANO_HAS_FIBERS
+    mutex_across_yields();
+    move_only_fibers();
+#endif
+}
@@ -0,0 +1,81 @@
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <cstring>
+#include <future>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "io_service.hpp"
+
+// The service needs POSIX file descriptors; on other targets there is nothing to check.
+#if AGANO_HAS_IO_SERVICE
+#include <fcntl.h>
+#include <unistd.h>
+
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {}
+    };
+};
+
+DetachedTask read_back(agano::IoService& io, const char* path, std::atomic<bool>& done) {
+    const i32 fd = (co_await io.async_open(path, O_RDONLY)).unwrap();
+    std::vector<std::byte> buffer(11);
+    assert((co_await io.async_read(fd, buffer, 0)).unwrap() == 11);
+    assert(std::memcmp(buffer.data(), "hello world", 11) == 0);
+    ::close(fd);
+    done = true;
+}
+
+// Writes a temporary file through the service, reads it back with futures and with a coroutine.
+void tmpfile_round_trip(usize queue_depth, agano::IoBackend backend) noexcept {
+    agano::IoService io{ queue_depth, backend };
+
+    char path[] = "/tmp/agano_io_XXXXXX";
+    ::close(::mkstemp(path));
+    const i32 fd = io.open(path, O_RDWR).get().unwrap();
+
+    // Many more requests than the queue holds, so the submission queue fills up.
+    const char message[] = "hello world";
+    std::vector<std::future<agano::IoResult>> writes;
+    for (u64 i = 0; i < 1000; ++i) {
+        writes.push_back(io.write(fd, std::as_bytes(std::span{ message, 11 }), i * 11));
+    }
+    for (auto& write : writes) {
+        assert(write.get().unwrap() == 11);
+    }
+    assert(io.fsync(fd).get().is_ok());
+
+    std::vector<std::byte> buffer(11);
+    assert(io.read(fd, buffer, 999 * 11).get().unwrap() == 11);
+    assert(std::memcmp(buffer.data(), message, 11) == 0);
+
+    bool bad_fd = false;
+    io.read(-1, buffer, 0).get().match([](i32) {}, [&](agano::IoError error) { bad_fd = error == agano::IoError{ EBADF }; });
+    assert(bad_fd);
+
+    std::atomic<bool> done{ false };
+    read_back(io, path, done);
+    while (!done) {
+        std::this_thread::yield();
+    }
+
+    ::close(fd);
+    ::unlink(path);
+}
+
+#endif
+
+int main() {
+#if AGANO_HAS_IO_SERVICE
+    tmpfile_round_trip(256, agano::IoBackend::eAuto);
+    tmpfile_round_trip(4, agano::IoBackend::eAuto);
+    tmpfile_round_trip(64, agano::IoBackend::eThreadPool);
+#endif
+}
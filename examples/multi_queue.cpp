@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+#include "multi_queue.hpp"
+
+// With one heap and one choice the queue is exact: elements come out in priority order.
+void single_heap_is_exact() noexcept {
+    agano::MultiQueue<int> queue{ 1, 1, 1 };
+    for (int value : { 5, 1, 9, 3, 7 }) {
+        queue.push(value);
+    }
+    assert(queue.size() == 5);
+
+    for (int expected : { 9, 7, 5, 3, 1 }) {
+        assert(queue.try_pop() == expected);
+    }
+    assert(queue.empty());
+    assert(!queue.try_pop().has_value());
+}
+
+// Relaxed pops still return every element exactly once, and the last ones are found by the full scan.
+void concurrent_push_pop() noexcept {
+    constexpr int per_thread = 20'000;
+    constexpr int threads = 4;
+
+    agano::MultiQueue<int, std::greater<int>> queue{ 2, threads };
+    std::vector<std::atomic<int>> seen(per_thread * threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < per_thread; ++i) {
+                queue.push(t * per_thread + i);
+                if (i % 2 == 1) {
+                    const auto value = queue.try_pop();
+                    assert(value.has_value());
+                    seen[*value].fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    while (auto value = queue.try_pop()) {
+        seen[*value].fetch_add(1, std::memory_order_relaxed);
+    }
+    assert(std::all_of(seen.begin(), seen.end(), [](const std::atomic<int>& count) { return count.load() == 1; }));
+}
+
+// A min-queue with several heaps pops roughly, not exactly, in order: early pops come from the smallest keys.
+void relaxed_order() noexcept {
+    agano::MultiQueue<int, std::greater<int>> queue{ 8, 1, 2 };
+    for (int i = 0; i < 10'000; ++i) {
+        queue.push(i);
+    }
+
+    long long sum = 0;
+    for (int i = 0; i < 1000; ++i) {
+        sum += *queue.try_pop();
+    }
+    // The first thousand pops would sum to 499'500 if exact; relaxation only adds a few ranks to each.
+    assert(sum >= 499'500 && sum < 499'500 + 1000 * 100);
+}
+
+int main() {
+    single_heap_is_exact();
+    concurrent_push_pop();
+    relaxed_order();
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cassert>
+#include <future>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+
+// Every parallel algorithm must give exactly what its sequential std counterpart gives.
+void matches_std(agano::ThreadPool& pool) noexcept {
+    std::mt19937_64 rng{ 1 };
+    for (usize n : { 0u, 1u, 10u, 100'000u, 1'000'003u }) {
+        std::vector<u64> values(n);
+        for (auto& value : values) {
+            value = rng() % 1000u;
+        }
+
+        auto sorted = values;
+        auto expected = values;
+        agano::parallel_sort(pool, sorted.begin(), sorted.end());
+        std::sort(expected.begin(), expected.end());
+        assert(sorted == expected);
+
+        std::vector<u64> scanned(n);
+        agano::parallel_inclusive_scan(pool, values.begin(), values.end(), scanned.begin());
+        std::inclusive_scan(values.begin(), values.end(), expected.begin());
+        assert(scanned == expected);
+
+        agano::parallel_exclusive_scan(pool, values.begin(), values.end(), scanned.begin(), u64{ 5 });
+        std::exclusive_scan(values.begin(), values.end(), expected.begin(), u64{ 5 });
+        assert(scanned == expected);
+
+        // In place.
+        agano::parallel_inclusive_scan(pool, scanned.begin(), scanned.end(), scanned.begin());
+        std::inclusive_scan(expected.begin(), expected.end(), expected.begin());
+        assert(scanned == expected);
+
+        std::vector<std::pair<int, usize>> items(n);
+        for (usize i = 0; i < n; ++i) {
+            items[i] = { static_cast<int>(rng() % 7u), i };
+        }
+        auto expected_items = items;
+        const auto pred = [](const auto& item) { return item.first < 3; };
+        const auto split = agano::parallel_stable_partition(pool, items.begin(), items.end(), pred);
+        const auto expected_split = std::stable_partition(expected_items.begin(), expected_items.end(), pred);
+        assert(items == expected_items);
+        assert(split - items.begin() == expected_split - expected_items.begin());
+
+        std::vector<std::string> strings(n / 10u);
+        for (auto& str : strings) {
+            str = std::to_string(rng());
+        }
+        auto expected_strings = strings;
+        agano::parallel_sort(strings.begin(), strings.end(), std::greater<>{});
+        std::sort(expected_strings.begin(), expected_strings.end(), std::greater<>{});
+        assert(strings == expected_strings);
+    }
+}
+
+// Tasks may own move-only state.
+void move_only_tasks(agano::ThreadPool& pool) noexcept {
+    std::promise<int> promise;
+    auto result = promise.get_future();
+    pool.submit([value = std::make_unique<int>(42), promise = std::move(promise)]() mutable {
+        promise.set_value(*value);
+    });
+    assert(result.get() == 42);
+}
+
+int main() {
+    agano::ThreadPool pool{ 4 };
+    matches_std(pool);
+    move_only_tasks(pool);
+}
@@ -0,0 +1,115 @@
+#include <atomic>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "agano.hpp"
+#include "atomic_arc.hpp"
+#include "persistent_map.hpp"
+
+template<>
+inline constexpr bool agano::send_tag_v<std::string> = true;
+
+template<>
+inline constexpr bool agano::send_tag_v<const std::string&> = true;
+
+using Map = agano::PersistentMap<int, std::string>;
+
+static_assert(agano::Send<Map> && agano::Sync<Map>);
+
+// Colliding hashes put keys in the same slots at every level, down to collision nodes.
+struct BadHash {
+    usize operator()(int key) const noexcept {
+        return static_cast<usize>(key & 1);
+    }
+};
+
+// Updates return new maps and leave the old ones untouched.
+void snapshots_are_immutable() noexcept {
+    const Map empty;
+    const Map one = empty.insert(1, "one");
+    const Map two = one.insert(2, "two");
+    const Map replaced = two.insert(1, "uno");
+    const Map erased = replaced.erase(2);
+
+    assert(empty.empty() && one.size() == 1 && two.size() == 2);
+    assert(*two.find(1) == "one" && *replaced.find(1) == "uno");
+    assert(erased.size() == 1 && !erased.contains(2) && two.contains(2));
+    assert(erased.erase(42).size() == 1);
+}
+
+// A transient builder loads in bulk, then behaves like any other map.
+void transient_bulk_load() noexcept {
+    constexpr int count = 100'000;
+    auto builder = Map{}.transient();
+    for (int key = 0; key < count; ++key) {
+        builder.insert(key, std::to_string(key));
+    }
+    builder.erase(0);
+    const Map map = std::move(builder).persistent();
+    assert(map.size() == count - 1 && !map.contains(0));
+
+    usize visited = 0;
+    map.for_each([&](int key, const std::string& value) {
+        assert(value == std::to_string(key));
+        ++visited;
+    });
+    assert(visited == map.size());
+
+    // Editing a transient taken from a map does not change the map.
+    auto edit = map.transient();
+    edit.insert(1, "changed");
+    assert(*map.find(1) == "1" && *edit.find(1) == "changed");
+}
+
+void hash_collisions() noexcept {
+    agano::PersistentMap<int, int, BadHash> map;
+    for (int key = 0; key < 100; ++key) {
+        map = std::move(map).insert(key, key * 2);
+    }
+    for (int key = 0; key < 100; key += 2) {
+        map = map.erase(key);
+    }
+    assert(map.size() == 50);
+    for (int key = 0; key < 100; ++key) {
+        assert(key % 2 == 0 ? !map.contains(key) : *map.find(key) == key * 2);
+    }
+}
+
+// Readers on other threads see whole snapshots published through an AtomicArc while a writer keeps updating.
+void published_through_atomic_arc() noexcept {
+    constexpr int versions = 500;
+    agano::AtomicArc<Map> current{ agano::make_arc<Map>(Map{}.insert(0, "0")) };
+    std::atomic<bool> done{ false };
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load(std::memory_order_acquire)) {
+                const auto snapshot = current.load();
+                const int newest = static_cast<int>(snapshot->size()) - 1;
+                assert(*snapshot->find(newest) == std::to_string(newest));
+            }
+        });
+    }
+
+    Map map = *current.load();
+    for (int version = 1; version < versions; ++version) {
+        map = map.insert(version, std::to_string(version));
+        current.store(agano::make_arc<Map>(map));
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    assert(current.load()->size() == versions);
+}
+
+int main() {
+    snapshots_are_immutable();
+    transient_bulk_load();
+    hash_collisions();
+    published_through_atomic_arc();
+    return 0;
+}
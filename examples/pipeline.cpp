@@ -0,0 +1,124 @@
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline.hpp"
+
+// Ordered stages must deliver results in input order even with several workers per stage.
+void keeps_order() noexcept {
+    std::vector<int> out;
+    {
+        auto pipeline = agano::make_pipeline<std::string>(8)
+            .stage("parse", 3, agano::StageOrder::eInOrder, [](std::string str) { return std::stoi(str); })
+            .stage("double", 4, agano::StageOrder::eUnordered, [] { return 0; }, [](int& calls, int value) {
+                ++calls;
+                return static_cast<long>(value) * 2;
+            })
+            .stage("narrow", 2, agano::StageOrder::eInOrder, [](long value) { return static_cast<int>(value); })
+            .sink("collect", 2, agano::StageOrder::eInOrder, [&](int value) { out.push_back(value); });
+
+        for (int i = 0; i < 20'000; ++i) {
+            assert(pipeline->push(std::to_string(i)));
+        }
+        pipeline->close();
+        pipeline->wait();
+        assert(!pipeline->push("0"));
+    }
+
+    assert(out.size() == 20'000);
+    for (int i = 0; i < 20'000; ++i) {
+        assert(out[i] == 2 * i);
+    }
+}
+
+// Move-only items flow through a small channel in FIFO order.
+void channel_fifo() noexcept {
+    agano::Channel<std::unique_ptr<int>> channel{ 3 };
+    std::thread producer{ [&] {
+        for (int i = 0; i < 100'000; ++i) {
+            assert(channel.push(std::make_unique<int>(i)));
+        }
+        channel.close();
+    } };
+
+    int expected = 0;
+    while (auto value = channel.pop()) {
+        assert(**value == expected++);
+    }
+    producer.join();
+    assert(expected == 100'000);
+}
+
+// Every push that reports success while close() races with it must reach a consumer.
+void close_loses_nothing() noexcept {
+    for (int round = 0; round < 200; ++round) {
+        agano::Channel<int> channel{ 4 };
+        std::atomic<int> pushed{ 0 };
+        std::atomic<int> popped{ 0 };
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < 3; ++p) {
+            threads.emplace_back([&] {
+                for (int i = 0; channel.push(int{ i }); ++i) {
+                    pushed.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        for (int c = 0; c < 2; ++c) {
+            threads.emplace_back([&] {
+                while (channel.pop()) {
+                    popped.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        std::this_thread::yield();
+        channel.close();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        assert(channel.is_drained());
+        assert(pushed.load() == popped.load());
+    }
+}
+
+// Producers racing with close() into in-order stages: every accepted item comes out, so wait() returns.
+void close_while_pushing() noexcept {
+    for (int round = 0; round < 50; ++round) {
+        std::atomic<int> accepted{ 0 };
+        std::atomic<int> delivered{ 0 };
+
+        auto pipeline = agano::make_pipeline<int>(4, 16)
+            .stage("square", 3, agano::StageOrder::eInOrder, [](int value) { return value * value; })
+            .sink("count", 2, agano::StageOrder::eInOrder, [&](int) { delivered.fetch_add(1, std::memory_order_relaxed); });
+
+        std::vector<std::thread> producers;
+        for (int p = 0; p < 4; ++p) {
+            producers.emplace_back([&] {
+                for (int i = 0; pipeline->push(int{ i }); ++i) {
+                    accepted.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        std::this_thread::yield();
+        pipeline->close();
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        pipeline->wait();
+
+        assert(delivered.load() == accepted.load());
+    }
+}
+
+int main() {
+    keeps_order();
+    close_while_pushing();
+    channel_fifo();
+    close_loses_nothing();
+}
@@ -0,0 +1,161 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "priority_pool.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+    // Holds a worker busy until opened, so the tasks queued behind it are ordered by the drain policy alone.
+    class Gate {
+    private:
+        std::atomic<bool> open_{ false };
+
+    public:
+        void wait() const noexcept {
+            while (!open_.load(std::memory_order_acquire)) {
+                std::this_thread::sleep_for(100us);
+            }
+        }
+
+        void open() noexcept {
+            open_.store(true, std::memory_order_release);
+        }
+    };
+
+    class Log {
+    private:
+        std::mutex mutex_;
+        std::vector<int> entries_;
+
+    public:
+        void push(int value) noexcept {
+            std::lock_guard lock{ mutex_ };
+            entries_.push_back(value);
+        }
+
+        std::vector<int> take() noexcept {
+            std::lock_guard lock{ mutex_ };
+            return std::move(entries_);
+        }
+    };
+}
+
+// Under the strict policy every queued class 0 task runs before any class 2 task, whatever the submit order.
+void strict_order() noexcept {
+    Gate gate;
+    Log log;
+    {
+        agano::PriorityPool pool{ { .thread_count = 1, .class_count = 3, .starvation_threshold = 0ms } };
+        pool.submit(0, [&] { gate.wait(); });
+        for (int i = 0; i < 4; ++i) {
+            pool.submit(2, [&] { log.push(2); });
+            pool.submit(1, [&] { log.push(1); });
+            pool.submit(0, [&] { log.push(0); });
+        }
+        gate.open();
+    }
+
+    const auto order = log.take();
+    assert((order == std::vector<int>{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 }));
+}
+
+// A reserved worker keeps serving class 0 while every general worker is stuck in background work.
+void reserved_worker() noexcept {
+    Gate gate;
+    std::atomic<bool> urgent_done{ false };
+    {
+        agano::PriorityPool pool{ { .thread_count = 2, .class_count = 2, .reserved_workers = 1 } };
+        pool.submit(1, [&] { gate.wait(); });
+        std::this_thread::sleep_for(10ms);
+
+        pool.submit(0, [&] { urgent_done.store(true, std::memory_order_release); });
+        const auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (!urgent_done.load(std::memory_order_acquire) && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(1ms);
+        }
+        assert(urgent_done.load());
+        gate.open();
+    }
+}
+
+// A low class that keeps losing to a busy high class still gets served once it has waited past the threshold.
+void starvation_protection() noexcept {
+    constexpr int high_tasks = 200;
+    Gate gate;
+    Log log;
+    {
+        agano::PriorityPool pool{ { .thread_count = 1, .class_count = 2, .starvation_threshold = 20ms } };
+        pool.submit(0, [&] { gate.wait(); });
+        pool.submit(1, [&] { log.push(1); });
+        for (int i = 0; i < high_tasks; ++i) {
+            pool.submit(0, [&] {
+                std::this_thread::sleep_for(1ms);
+                log.push(0);
+            });
+        }
+        gate.open();
+    }
+
+    const auto order = log.take();
+    assert(order.size() == high_tasks + 1);
+    assert(order.back() == 0);
+}
+
+// Queue time is measured from submit to start, per class.
+void queue_time_stats() noexcept {
+    Gate gate;
+    agano::PriorityPool pool{ { .thread_count = 1, .class_count = 2 } };
+    pool.submit(0, [&] { gate.wait(); });
+    for (int i = 0; i < 10; ++i) {
+        pool.submit(1, [] {});
+    }
+    std::this_thread::sleep_for(20ms);
+    gate.open();
+
+    while (pool.stats()[1].executed != 10) {
+        std::this_thread::sleep_for(1ms);
+    }
+    const auto stats = pool.stats();
+    assert(stats.size() == 2);
+    assert(stats[0].executed == 1);
+    assert(stats[1].queued == 0);
+    assert(stats[1].max_queue_time >= 20ms);
+    assert(stats[1].mean_queue_time <= stats[1].max_queue_time);
+}
+
+// Every submit into an idle pool must wake a worker; a lost wake-up leaves a producer waiting forever.
+void wakes_idle_workers() noexcept {
+    // Declared before the pool, so a task still inside notify_one() never outlives its counter.
+    std::vector<std::atomic<int>> done(3);
+    agano::PriorityPool pool{ { .thread_count = 2, .class_count = 2, .reserved_workers = 1 } };
+
+    std::vector<std::thread> producers;
+    for (usize p = 0; p < done.size(); ++p) {
+        producers.emplace_back([&pool, &counter = done[p], p] {
+            for (int i = 0; i < 2000; ++i) {
+                pool.submit((p + static_cast<usize>(i)) % 2, [&counter] {
+                    counter.fetch_add(1, std::memory_order_release);
+                    counter.notify_one();
+                });
+                counter.wait(i, std::memory_order_acquire);
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+}
+
+int main() {
+    strict_order();
+    wakes_idle_workers();
+    reserved_worker();
+    starvation_protection();
+    queue_time_stats();
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "rate_limiter.hpp"
+
+using namespace std::chrono_literals;
+
+// A fresh limiter hands out its burst at once and then refills at the configured rate.
+void burst_then_refill() noexcept {
+    agano::RateLimiter limiter{ 1000.0, 100 };
+    int granted = 0;
+    for (int i = 0; i < 1000; ++i) {
+        granted += limiter.try_acquire() ? 1 : 0;
+    }
+    // The coarse clock may tick during the loop and refill a few tokens.
+    assert(granted >= 100 && granted <= 120);
+    assert(!limiter.try_acquire(101));
+
+    std::this_thread::sleep_for(50ms);
+    const u64 available = limiter.available();
+    assert(available >= 30 && available <= 100);
+}
+
+// Concurrent takers never get more than the burst plus what was refilled, whatever the sharding.
+void shared_between_threads() noexcept {
+    for (usize shards : { 1u, 4u }) {
+        agano::RateLimiter limiter{ 100'000.0, 1000, shards };
+        std::atomic<u64> granted{ 0 };
+        const auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                while (std::chrono::steady_clock::now() - start < 200ms) {
+                    granted += limiter.try_acquire() ? 1u : 0u;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        assert(limiter.shard_count() == shards);
+        assert(granted.load() <= 1000 + static_cast<u64>(100'000.0 * (elapsed + 0.01)));
+    }
+}
+
+// acquire() blocks until the tokens are refilled.
+void acquire_waits() noexcept {
+    agano::RateLimiter limiter{ 200.0, 10 };
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 50; ++i) {
+        limiter.acquire();
+    }
+    // 40 tokens past the burst at 200 per second.
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    assert(elapsed >= 150ms && elapsed < 2s);
+}
+
+int main() {
+    burst_then_refill();
+    shared_between_threads();
+    acquire_waits();
+}
@@ -0,0 +1,95 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "channel.hpp"
+
+// select() interleaves several sources, keeps the order within each one and ends once all are drained.
+void fan_in() noexcept {
+    agano::Channel<int> a{ 4 };
+    agano::Channel<std::string> b{ 4 };
+    agano::Channel<int> c{ 2 };
+
+    // Nothing arrives, so select_for() times out.
+    assert(agano::select_for(std::chrono::milliseconds{ 20 }, a, b).index() == 0);
+
+    std::thread pa{ [&] {
+        for (int i = 0; i < 50'000; ++i) {
+            assert(a.push(int{ i }));
+        }
+        a.close();
+    } };
+    std::thread pb{ [&] {
+        for (int i = 0; i < 30'000; ++i) {
+            assert(b.push(std::to_string(i)));
+        }
+        b.close();
+    } };
+    std::thread pc{ [&] {
+        for (int i = 0; i < 20'000; ++i) {
+            assert(c.push(int{ i }));
+        }
+        c.close();
+    } };
+
+    int na = 0;
+    int nb = 0;
+    int nc = 0;
+    while (true) {
+        auto result = agano::select(a, b, c);
+        if (result.index() == 0) {
+            break;
+        }
+
+        if (result.index() == 1) {
+            assert(std::get<1>(result) == na++);
+        }
+        else if (result.index() == 2) {
+            assert(std::get<2>(result) == std::to_string(nb++));
+        }
+        else {
+            assert(std::get<3>(result) == nc++);
+        }
+    }
+
+    pa.join();
+    pb.join();
+    pc.join();
+    assert(na == 50'000 && nb == 30'000 && nc == 20'000);
+}
+
+// Several threads may select on the same channels at once; every item is received exactly once.
+void shared_selectors() noexcept {
+    agano::Channel<int> x{ 8 };
+    agano::Channel<int> y{ 8 };
+    std::atomic<int> received{ 0 };
+
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < 4; ++i) {
+        consumers.emplace_back([&] {
+            while (agano::select(x, y).index() != 0) {
+                ++received;
+            }
+        });
+    }
+
+    for (int i = 0; i < 20'000; ++i) {
+        assert(x.push(int{ i }));
+        assert(y.push(int{ i }));
+    }
+    x.close();
+    y.close();
+
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+    assert(received == 40'000);
+}
+
+int main() {
+    fan_in();
+    shared_selectors();
+}
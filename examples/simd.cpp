@@ -0,0 +1,114 @@
+#include <cassert>
+#include <bit>
+#include <random>
+#include <vector>
+
+#include <fuwa/simd.hpp>
+
+#include "parallel.hpp"
+
+// This file is built twice: natively and with FUWA_SIMD_SCALAR. Both builds check every operation
+// against the same plain loops, so the native backend and the fallback agree lane for lane.
+template<typename V, typename Lane>
+void matches_reference(std::mt19937_64& rng) noexcept {
+    constexpr usize lanes = V::lanes;
+    for (usize round = 0; round < 1000; ++round) {
+        Lane a[lanes];
+        Lane b[lanes];
+        for (usize i = 0; i < lanes; ++i) {
+            a[i] = static_cast<Lane>(rng());
+            // Make roughly half of the lanes equal so that cmp_eq sees both outcomes.
+            b[i] = (rng() & 1u) != 0 ? a[i] : static_cast<Lane>(rng());
+        }
+
+        const V va = V::load(a);
+        const V vb = V::load(b);
+
+        Lane out[lanes];
+        va.store(out);
+        for (usize i = 0; i < lanes; ++i) {
+            assert(out[i] == a[i]);
+        }
+
+        V::splat(a[0]).store(out);
+        for (usize i = 0; i < lanes; ++i) {
+            assert(out[i] == a[0]);
+        }
+
+        (va & vb).store(out);
+        for (usize i = 0; i < lanes; ++i) {
+            assert(out[i] == static_cast<Lane>(a[i] & b[i]));
+        }
+        (va | vb).store(out);
+        for (usize i = 0; i < lanes; ++i) {
+            assert(out[i] == static_cast<Lane>(a[i] | b[i]));
+        }
+        (va ^ vb).store(out);
+        for (usize i = 0; i < lanes; ++i) {
+            assert(out[i] == static_cast<Lane>(a[i] ^ b[i]));
+        }
+        (~va).store(out);
+        for (usize i = 0; i < lanes; ++i) {
+            assert(out[i] == static_cast<Lane>(~a[i]));
+        }
+
+        u32 bits = 0;
+        u32 expected_mask = 0;
+        for (usize i = 0; i < lanes; ++i) {
+            bits += static_cast<u32>(std::popcount(a[i]));
+            expected_mask |= a[i] == b[i] ? 1u << i : 0u;
+        }
+        assert(eh::simd::popcount(va) == bits);
+
+        const V equal = eh::simd::cmp_eq(va, vb);
+        equal.store(out);
+        for (usize i = 0; i < lanes; ++i) {
+            assert(out[i] == (a[i] == b[i] ? static_cast<Lane>(~Lane{ 0 }) : Lane{ 0 }));
+        }
+        assert(eh::simd::movemask(equal) == expected_mask);
+        assert(eh::simd::any(equal) == (expected_mask != 0));
+        assert(eh::simd::all(equal) == (expected_mask == V::full_mask));
+        assert(eh::simd::none(equal) == (expected_mask == 0));
+    }
+
+    // The edges that random data almost never hits.
+    assert(eh::simd::all(eh::simd::cmp_eq(V::splat(Lane{ 7 }), V::splat(Lane{ 7 }))));
+    assert(eh::simd::none(eh::simd::cmp_eq(V::splat(Lane{ 7 }), V::splat(Lane{ 8 }))));
+    assert(eh::simd::popcount(V::splat(static_cast<Lane>(~Lane{ 0 }))) == lanes * sizeof(Lane) * 8);
+}
+
+// Every vector type of the backend this build picked.
+void all_types() noexcept {
+    std::mt19937_64 rng{ 42 };
+    matches_reference<eh::simd::u8x16, u8>(rng);
+    matches_reference<eh::simd::u32x4, u32>(rng);
+    matches_reference<eh::simd::u64x2, u64>(rng);
+    matches_reference<eh::simd::u8x32, u8>(rng);
+    matches_reference<eh::simd::u64x4, u64>(rng);
+}
+
+// parallel_stable_partition scans its flags with u8x32 masks; mix long uniform runs with noisy stretches.
+void partition_runs() noexcept {
+    agano::ThreadPool pool{ 4 };
+    constexpr usize n = 300'001;
+
+    std::vector<u32> values(n);
+    std::mt19937_64 rng{ 7 };
+    for (usize i = 0; i < n; ++i) {
+        const usize run = i / 1000;
+        const bool even = run % 3 == 0 ? true : run % 3 == 1 ? false : (rng() & 1u) != 0;
+        values[i] = static_cast<u32>(i) * 2u + (even ? 0u : 1u);
+    }
+
+    std::vector<u32> expected = values;
+    std::stable_partition(expected.begin(), expected.end(), [](u32 x) { return x % 2 == 0; });
+
+    const auto middle = agano::parallel_stable_partition(pool, values.begin(), values.end(), [](u32 x) { return x % 2 == 0; });
+    assert(values == expected);
+    assert(middle == values.begin() + (std::partition_point(expected.begin(), expected.end(), [](u32 x) { return x % 2 == 0; }) - expected.begin()));
+}
+
+int main() {
+    all_types();
+    partition_runs();
+}
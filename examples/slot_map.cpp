@@ -0,0 +1,83 @@
+#include <atomic>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "slot_map.hpp"
+
+// Stale handles stop resolving once their element is erased, even after the slot is reused.
+void generations() noexcept {
+    agano::SlotMap<std::string> map;
+    const auto a = map.insert("a");
+    const auto b = map.insert("b");
+    const auto c = map.insert("c");
+
+    assert(map.erase(a) == std::string{ "a" });
+    assert(!map.contains(a) && !map.erase(a).has_value());
+
+    const auto d = map.insert("d");
+    assert(d.index() == a.index() && d.generation() != a.generation());
+    assert(map.get(a) == nullptr && *map.get(d) == "d");
+    assert(!map.contains(agano::SlotHandle{}));
+
+    // Erase swaps the last value into the hole, so values() stays dense and handles keep resolving.
+    assert(map.size() == 3 && map.values().size() == 3);
+    for (usize position = 0; position < map.values().size(); ++position) {
+        assert(map.get(map.handle_at(position)) == &map.values()[position]);
+    }
+    assert(*map.get(b) == "b" && *map.get(c) == "c");
+}
+
+// Threads insert and erase their own elements concurrently; an erased handle never resolves again.
+void concurrent() noexcept {
+    constexpr int threads = 4;
+    constexpr int rounds = 20'000;
+    agano::ConcurrentSlotMap<int> map{ 64 };
+    std::atomic<u64> erased{ agano::SlotHandle{}.raw() };
+    std::atomic<bool> done{ false };
+
+    // Only checks handles, never dereferences: values may be destroyed under a reader that did not coordinate.
+    std::thread reader{ [&] {
+        while (!done.load(std::memory_order_acquire)) {
+            assert(!map.contains(agano::SlotHandle::from_raw(erased.load(std::memory_order_acquire))));
+        }
+    } };
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < rounds; ++i) {
+                const auto handle = map.insert(t * rounds + i);
+                assert(handle.has_value());
+                assert(*map.get(*handle) == t * rounds + i);
+
+                assert(map.erase(*handle));
+                assert(!map.erase(*handle) && map.get(*handle) == nullptr);
+                erased.store(handle->raw(), std::memory_order_release);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    done.store(true, std::memory_order_release);
+    reader.join();
+    assert(map.size() == 0);
+
+    // Capacity is fixed, and slots freed by erase are handed out again.
+    std::vector<agano::SlotHandle> handles;
+    while (const auto handle = map.insert(1)) {
+        handles.push_back(*handle);
+    }
+    assert(handles.size() == map.capacity());
+    usize visited = 0;
+    map.for_each([&](agano::SlotHandle, int& value) { visited += static_cast<usize>(value); });
+    assert(visited == map.capacity());
+}
+
+int main() {
+    generations();
+    concurrent();
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <cassert>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "string_interner.hpp"
+
+// Ids are dense and stable, and views point into the interner rather than at the caller's string.
+void ids_and_views() noexcept {
+    agano::StringInterner interner;
+    std::string tag = "region";
+    const u32 region = interner.intern(tag);
+    const u32 host = interner.intern("host");
+    assert(region == 0 && host == 1);
+    assert(interner.intern("region") == region);
+
+    tag = "changed";
+    assert(interner.view(region) == "region" && interner.view(region).data() != tag.data());
+    assert(interner.find("host") == host && !interner.find("missing").has_value());
+
+    // Empty strings and strings bigger than an arena chunk are interned like any other.
+    const std::string big(100'000, 'x');
+    const u32 empty = interner.intern("");
+    const u32 large = interner.intern(big);
+    assert(interner.view(empty).empty() && interner.view(large) == big);
+    assert(interner.intern(big) == large && interner.size() == 4);
+}
+
+// Threads intern overlapping sets, through several table resizes; each string gets exactly one id.
+void concurrent_interning() noexcept {
+    constexpr int strings = 5000;
+    constexpr int threads = 4;
+    agano::StringInterner interner;
+    std::vector<std::vector<u32>> ids(threads, std::vector<u32>(strings));
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < strings; ++i) {
+                // Each thread starts at a different offset and runs into the others' first interns.
+                const int s = (i + t * strings / threads) % strings;
+                ids[t][s] = interner.intern("key-" + std::to_string(s));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    assert(interner.size() == strings);
+    for (int s = 0; s < strings; ++s) {
+        for (int t = 1; t < threads; ++t) {
+            assert(ids[t][s] == ids[0][s]);
+        }
+        assert(interner.view(ids[0][s]) == "key-" + std::to_string(s));
+    }
+}
+
+int main() {
+    ids_and_views();
+    concurrent_interning();
+    return 0;
+}
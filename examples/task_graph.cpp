@@ -0,0 +1,57 @@
+#include <atomic>
+#include <cassert>
+#include <thread>
+
+#include "task_graph.hpp"
+
+// Builds a diamond plus an independent branch and checks that every node runs after its predecessors.
+void respects_edges(agano::ThreadPool& pool) noexcept {
+    agano::TaskGraph graph;
+    std::atomic<int> order[6];
+    std::atomic<int> tick{ 0 };
+
+    const auto a = graph.add([&] { order[0] = tick++; });
+    const auto b = graph.add([&] { order[1] = tick++; }, { a });
+    const auto c = graph.add([&] { order[2] = tick++; }, { a });
+    const auto d = graph.add([&] { order[3] = tick++; }, { b, c });
+    const auto e = graph.add([&] { order[4] = tick++; });
+    graph.add([&] { order[5] = tick++; }, { d, e });
+    assert(graph.size() == 6);
+
+    // The graph is reusable.
+    for (int run = 0; run < 1000; ++run) {
+        tick = 0;
+        graph.run(pool);
+        assert(tick == 6);
+        assert(order[0] < order[1] && order[0] < order[2]);
+        assert(order[1] < order[3] && order[2] < order[3]);
+        assert(order[3] < order[5] && order[4] < order[5]);
+    }
+}
+
+// Running a graph from a pool worker must not deadlock, even on a single-threaded pool.
+void runs_from_worker() noexcept {
+    agano::ThreadPool pool{ 1 };
+    agano::TaskGraph graph;
+    std::atomic<int> count{ 0 };
+    const auto root = graph.add([&] { ++count; });
+    for (int i = 0; i < 8; ++i) {
+        graph.add([&] { ++count; }, { root });
+    }
+
+    std::atomic<bool> done{ false };
+    pool.submit([&] {
+        graph.run(pool);
+        done = true;
+    });
+    while (!done) {
+        std::this_thread::yield();
+    }
+    assert(count == 9);
+}
+
+int main() {
+    agano::ThreadPool pool{ 3 };
+    respects_edges(pool);
+    runs_from_worker();
+}
@@ -0,0 +1,115 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <deque>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+
+#include "agano.hpp"
+#include "channel.hpp"
+#include "task_scope.hpp"
+
+enum class ScopeError : u32 {
+    eNone = 0,
+    eFailed,
+};
+
+template<>
+struct eh::ErrorTypeTrait<ScopeError> {
+    static std::string_view description(ScopeError) noexcept { return "task failed"; }
+    static std::string_view stringify(ScopeError) noexcept { return "eFailed"; }
+    static ScopeError default_value() noexcept { return ScopeError::eNone; }
+};
+
+template<>
+inline constexpr bool agano::send_tag_v<std::deque<int>> = true;
+
+// The first error cancels siblings blocked in Channel::pop, Channel::push and Synced::lock_when.
+void error_cancels_siblings(agano::ThreadPool& pool) noexcept {
+    agano::Channel<int> empty{ 4 };
+    agano::Channel<int> full{ 2 };
+    agano::Synced<std::deque<int>> queue{};
+    std::atomic<int> cancelled{ 0 };
+
+    agano::TaskScope<ScopeError> scope{ pool };
+    scope.spawn([&](std::stop_token token) -> eh::Result<int, ScopeError> {
+        assert(!empty.pop(token));
+        ++cancelled;
+        return 1;
+    });
+    scope.spawn([&](std::stop_token token) {
+        assert(!queue.lock_when(token, [](const std::deque<int>& items) { return !items.empty(); }));
+        ++cancelled;
+    });
+    scope.spawn([&](std::stop_token token) {
+        while (full.push(1, token)) {}
+        ++cancelled;
+    });
+    scope.spawn([]() -> eh::Result<int, ScopeError> {
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+        return eh::Error<ScopeError>{ ScopeError::eFailed };
+    });
+
+    bool failed = false;
+    scope.join().match([](auto) {}, [&](ScopeError error) { failed = error == ScopeError::eFailed; });
+    assert(failed);
+    assert(cancelled == 3);
+}
+
+// lock_when wakes up on notify_all once the predicate holds.
+void lock_when_notified() noexcept {
+    agano::Synced<std::deque<int>> queue{};
+    std::thread producer{ [&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+        queue.lock()->push_back(5);
+        queue.notify_all();
+    } };
+
+    {
+        auto locked = queue.lock_when([](const std::deque<int>& items) { return !items.empty(); });
+        assert(locked->front() == 5);
+    }
+    producer.join();
+}
+
+// Requesting stop while holding the Synced lock must not deadlock with a waiter's stop callback.
+void stop_while_locked() noexcept {
+    agano::Synced<std::deque<int>> queue{};
+    std::stop_source source;
+    std::atomic<bool> waiting{ false };
+
+    std::thread waiter{ [&] {
+        waiting = true;
+        assert(!queue.lock_when(source.get_token(), [](const std::deque<int>& items) { return !items.empty(); }));
+    } };
+
+    while (!waiting) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+    {
+        auto locked = queue.lock();
+        source.request_stop();
+    }
+    waiter.join();
+}
+
+// A scope without errors runs every task.
+void runs_everything(agano::ThreadPool& pool) noexcept {
+    agano::TaskScope<ScopeError> scope{ pool };
+    std::atomic<int> count{ 0 };
+    for (int i = 0; i < 100; ++i) {
+        scope.spawn([&] { ++count; });
+    }
+    assert(scope.join().is_ok());
+    assert(count == 100);
+}
+
+int main() {
+    agano::ThreadPool pool{ 4 };
+    error_cancels_siblings(pool);
+    lock_when_notified();
+    stop_while_locked();
+    runs_everything(pool);
+}
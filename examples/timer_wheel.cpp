@@ -0,0 +1,88 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "timer_wheel.hpp"
+
+template<>
+inline constexpr bool agano::send_tag_v<std::deque<int>> = true;
+
+using namespace std::chrono_literals;
+
+// Timers never fire early, including ones that start on a coarser level and get cascaded down.
+void never_early() noexcept {
+    agano::TimerWheel wheel{ 20us };
+    const auto start = agano::TimerWheel::Clock::now();
+    std::atomic<int> fired{ 0 };
+    std::atomic<int> early{ 0 };
+
+    // 20us ticks: 300us stays on level 0, 30ms needs level 1 and 400ms needs level 2.
+    const std::chrono::microseconds delays[] = { 300us, 2ms, 30ms, 31ms, 400ms };
+    for (auto delay : delays) {
+        wheel.schedule_at(start + delay, [&, delay, start] {
+            if (agano::TimerWheel::Clock::now() - start < delay) {
+                ++early;
+            }
+            ++fired;
+        });
+    }
+
+    // A timer scheduled while the service thread sleeps towards a later deadline must still fire on time.
+    std::this_thread::sleep_for(5ms);
+    const auto late_start = agano::TimerWheel::Clock::now();
+    std::atomic<bool> short_fired{ false };
+    wheel.schedule_after(1ms, [&] { short_fired = true; });
+    while (!short_fired) {
+        std::this_thread::yield();
+    }
+    assert(agano::TimerWheel::Clock::now() - late_start < 20ms);
+
+    while (fired != 5) {
+        std::this_thread::sleep_for(1ms);
+    }
+    assert(early == 0);
+    assert(wheel.size() == 0);
+}
+
+// Cancelled timers do not run; cancelling twice fails.
+void cancel() noexcept {
+    agano::TimerWheel wheel;
+    std::atomic<int> fired{ 0 };
+    std::vector<agano::TimerWheel::TimerId> ids;
+    for (int i = 0; i < 1000; ++i) {
+        ids.push_back(wheel.schedule_after(std::chrono::milliseconds{ 50 + i }, [&] { ++fired; }));
+    }
+    assert(wheel.size() == 1000);
+
+    for (auto id : ids) {
+        assert(wheel.cancel(id));
+    }
+    assert(!wheel.cancel(ids.front()));
+    assert(wheel.size() == 0);
+
+    wheel.schedule_after(10ms, [&] { ++fired; });
+    std::this_thread::sleep_for(100ms);
+    assert(fired == 1);
+}
+
+// Timed waits on Synced and Channel give up after the timeout.
+void timed_waits() noexcept {
+    agano::Synced<std::deque<int>> queue{};
+    const auto start = agano::TimerWheel::Clock::now();
+    assert(!agano::lock_when_for(queue, 30ms, [](const std::deque<int>& items) { return !items.empty(); }));
+    assert(agano::TimerWheel::Clock::now() - start >= 30ms);
+
+    agano::Channel<int> channel{ 4 };
+    assert(!agano::pop_for(channel, 10ms));
+    assert(channel.try_push(5));
+    assert(agano::pop_for(channel, 10ms) == 5);
+}
+
+int main() {
+    never_early();
+    cancel();
+    timed_waits();
+}
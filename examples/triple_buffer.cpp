@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <thread>
+
+#include "triple_buffer.hpp"
+
+struct Frame {
+    u64 sequence = 0;
+    std::array<u64, 32> pixels{};
+};
+
+// Before the first publish the consumer sees the initial value; afterwards only the newest one.
+void latest_value_wins() noexcept {
+    agano::TripleBuffer<int> buffer{ -1 };
+    assert(!buffer.has_update() && buffer.read() == -1);
+
+    buffer.publish(1);
+    buffer.publish(2);
+    buffer.write_buffer() = 3;
+    buffer.publish();
+    assert(buffer.has_update());
+    assert(buffer.read() == 3);
+    assert(!buffer.has_update() && buffer.read() == 3);
+
+    buffer.read_buffer() = 30;
+    assert(buffer.read() == 30);
+}
+
+// A fast producer and a slower consumer: every frame read is whole, and sequence numbers never go back.
+void producer_and_consumer() noexcept {
+    constexpr u64 frames = 200'000;
+    agano::TripleBuffer<Frame> buffer;
+    std::atomic<bool> done{ false };
+
+    std::thread consumer{ [&] {
+        u64 last = 0;
+        while (true) {
+            const bool finished = done.load(std::memory_order_acquire);
+            const Frame& frame = buffer.read();
+            assert(std::all_of(frame.pixels.begin(), frame.pixels.end(), [&](u64 pixel) { return pixel == frame.sequence; }));
+            assert(frame.sequence >= last);
+            last = frame.sequence;
+            if (finished) {
+                break;
+            }
+        }
+        assert(last == frames);
+    } };
+
+    for (u64 sequence = 1; sequence <= frames; ++sequence) {
+        Frame& frame = buffer.write_buffer();
+        frame.sequence = sequence;
+        frame.pixels.fill(sequence);
+        buffer.publish();
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+}
+
+int main() {
+    latest_value_wins();
+    producer_and_consumer();
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+#include "versioned.hpp"
+
+// Two accounts; every transfer keeps the total, so a torn read would show up as a wrong sum.
+struct Accounts {
+    i64 a = 0;
+    i64 b = 0;
+};
+
+// A snapshot keeps seeing its version after later commits, and old versions go once nobody can see them.
+void snapshot_isolation() noexcept {
+    agano::Versioned<int> value{ 0 };
+    assert(value.timestamp() == 0 && value.version_count() == 1);
+
+    auto before = value.snapshot();
+    assert(value.commit(1) == 1);
+    assert(value.update([](int latest) { return latest + 1; }) == 2);
+
+    assert(*before == 0 && before.timestamp() == 0);
+    assert(*value.snapshot() == 2);
+    assert(value.version_count() == 3);
+
+    before = value.snapshot();
+    value.collect();
+    assert(value.version_count() == 1);
+    assert(*before == 2 && before.timestamp() == 2);
+}
+
+// Long readers never block the writer, and every snapshot they take is a consistent, non-decreasing state.
+void readers_and_writer() noexcept {
+    constexpr i64 total = 1000;
+    constexpr int transfers = 20'000;
+    agano::Versioned<Accounts> accounts{ Accounts{ total, 0 }, 8 };
+    std::atomic<bool> done{ false };
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            u64 last = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                const auto snapshot = accounts.snapshot();
+                assert(snapshot->a + snapshot->b == total);
+                assert(snapshot.timestamp() >= last);
+                last = snapshot.timestamp();
+            }
+        });
+    }
+
+    for (int i = 0; i < transfers; ++i) {
+        accounts.update([i](const Accounts& latest) {
+            const i64 amount = (i % 7) - 3;
+            return Accounts{ latest.a - amount, latest.b + amount };
+        });
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    assert(accounts.timestamp() == transfers);
+    accounts.collect();
+    assert(accounts.version_count() == 1);
+}
+
+int main() {
+    snapshot_isolation();
+    readers_and_writer();
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "channel.hpp"
+#include "task_graph.hpp"
+#include "wait_strategy.hpp"
+
+// WaitMutex under every strategy keeps the critical section exclusive.
+template<typename Wait>
+void mutex_is_exclusive() noexcept {
+    agano::WaitSynced<int, Wait> counter{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 5000; ++i) {
+                auto locked = counter.lock();
+                ++*locked;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(*counter.lock() == 20'000);
+}
+
+// Blocking channel operations and TaskGraph::run wait with the given strategy.
+template<typename Wait>
+void channel_and_graph(Wait wait) noexcept {
+    agano::Channel<int, Wait> channel{ 2, wait };
+    std::thread producer{ [&] {
+        for (int i = 0; i < 2000; ++i) {
+            assert(channel.push(int{ i }));
+        }
+        channel.close();
+    } };
+    int expected = 0;
+    while (auto value = channel.pop()) {
+        assert(*value == expected++);
+    }
+    producer.join();
+    assert(expected == 2000);
+
+    agano::ThreadPool pool{ 2 };
+    agano::TaskGraph graph;
+    std::atomic<int> count{ 0 };
+    const auto root = graph.add([&] { ++count; });
+    for (int i = 0; i < 16; ++i) {
+        graph.add([&] { ++count; }, { root });
+    }
+    for (int run = 0; run < 100; ++run) {
+        graph.run(pool, wait);
+    }
+    assert(count == 1700);
+}
+
+// lock_when wakes up once the predicate holds, whatever the mutex waits with.
+void lock_when_on_wait_mutex() noexcept {
+    agano::WaitSynced<int> value{ 0 };
+    std::thread writer{ [&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+        *value.lock() = 1;
+        value.notify_all();
+    } };
+    assert(*value.lock_when([](const int& v) { return v == 1; }) == 1);
+    writer.join();
+}
+
+int main() {
+    mutex_is_exclusive<agano::BusySpinWait>();
+    mutex_is_exclusive<agano::YieldingWait>();
+    mutex_is_exclusive<agano::SpinThenYieldWait>();
+    mutex_is_exclusive<agano::SpinThenParkWait>();
+    mutex_is_exclusive<agano::BlockingWait>();
+
+    channel_and_graph(agano::YieldingWait{});
+    channel_and_graph(agano::SpinThenParkWait{ 256 });
+    channel_and_graph(agano::BlockingWait{});
+
+    lock_when_on_wait_mutex();
+}